@@ -69,6 +69,11 @@ contains(DISABLE_PLATFORM_EXT, YES) {
     DEFINES += QTOX_PLATFORM_EXT
 }
 
+# Opt-in accounting of operator new, SQLite and video frame allocations per subsystem, for memory profiling
+contains(ENABLE_ALLOC_PROFILING, YES) {
+    DEFINES += QTOX_ALLOC_PROFILING
+}
+
 contains(JENKINS,YES) {
     INCLUDEPATH += ./libs/include/
 } else {
@@ -243,6 +248,7 @@ HEADERS  += \
     src/group.h \
     src/grouplist.h \
     src/ipc.h \
+    src/allocstats.h \
     src/nexus.h \
     src/audio/audio.h \
     src/chatlog/chatlog.h \
@@ -250,6 +256,7 @@ HEADERS  += \
     src/chatlog/chatlinecontent.h \
     src/chatlog/chatlinecontentproxy.h \
     src/chatlog/content/text.h \
+    src/chatlog/content/statictext.h \
     src/chatlog/content/spinner.h \
     src/chatlog/content/filetransferwidget.h \
     src/chatlog/chatmessage.h \
@@ -293,11 +300,14 @@ HEADERS  += \
     src/video/videoframe.h \
     src/video/videosource.h \
     src/video/cameradevice.h \
+    src/video/cameracache.h \
     src/video/camerasource.h \
     src/video/corevideosource.h \
     src/video/videomode.h \
     src/video/genericnetcamview.h \
     src/video/groupnetcamview.h \
+    src/video/videogrid.h \
+    src/video/screenchangedetector.h \
     src/widget/emoticonswidget.h \
     src/widget/style.h \
     src/widget/tool/croppinglabel.h \
@@ -313,6 +323,7 @@ HEADERS  += \
     src/widget/form/settings/privacyform.h \
     src/widget/form/settings/avform.h \
     src/widget/form/filesform.h \
+    src/widget/form/filetransfermodel.h \
     src/widget/form/profileform.h \
     src/widget/tool/chattextedit.h \
     src/widget/tool/friendrequestdialog.h \
@@ -324,6 +335,7 @@ HEADERS  += \
     src/widget/form/genericchatform.h \
     src/widget/tool/adjustingscrollarea.h \
     src/widget/form/loadhistorydialog.h \
+    src/widget/form/searchform.h \
     src/widget/form/setpassworddialog.h \
     src/widget/form/tabcompleter.h \
     src/widget/tool/callconfirmwidget.h \
@@ -359,6 +371,7 @@ HEADERS  += \
 
 SOURCES += \
     src/ipc.cpp \
+    src/allocstats.cpp \
     src/friend.cpp \
     src/friendlist.cpp \
     src/group.cpp \
@@ -380,6 +393,7 @@ SOURCES += \
     src/chatlog/chatlinecontent.cpp \
     src/chatlog/chatlinecontentproxy.cpp \
     src/chatlog/content/text.cpp \
+    src/chatlog/content/statictext.cpp \
     src/chatlog/content/spinner.cpp \
     src/chatlog/content/filetransferwidget.cpp \
     src/chatlog/chatmessage.cpp \
@@ -410,10 +424,13 @@ SOURCES += \
     src/persistence/history.cpp \
     src/video/videoframe.cpp \
     src/video/cameradevice.cpp \
+    src/video/cameracache.cpp \
     src/video/camerasource.cpp \
     src/video/corevideosource.cpp \
     src/video/genericnetcamview.cpp \
     src/video/groupnetcamview.cpp \
+    src/video/videogrid.cpp \
+    src/video/screenchangedetector.cpp \
     src/video/netcamview.cpp \
     src/video/videosurface.cpp \
     src/widget/form/addfriendform.cpp \
@@ -423,12 +440,14 @@ SOURCES += \
     src/widget/form/settings/avform.cpp \
     src/widget/form/profileform.cpp \
     src/widget/form/filesform.cpp \
+    src/widget/form/filetransfermodel.cpp \
     src/widget/tool/chattextedit.cpp \
     src/widget/tool/friendrequestdialog.cpp \
     src/widget/widget.cpp \
     src/widget/friendlistwidget.cpp \
     src/widget/tool/adjustingscrollarea.cpp \
     src/widget/form/loadhistorydialog.cpp \
+    src/widget/form/searchform.cpp \
     src/widget/form/setpassworddialog.cpp \
     src/widget/form/tabcompleter.cpp \
     src/widget/flowlayout.cpp \
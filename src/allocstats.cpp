@@ -0,0 +1,292 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "allocstats.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QStringList>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/**
+@namespace AllocStats
+@brief Accounts allocations to the subsystem that made them.
+
+Only built with QTOX_ALLOC_PROFILING (qmake ENABLE_ALLOC_PROFILING=YES), which
+replaces the global operator new and delete. Each block carries a small header
+with its size and owner, so frees are charged back to the subsystem that
+allocated it, whatever thread or scope releases it.
+
+Memory that doesn't come from operator new is reported with allocated() and
+freed() by its owner: SQLite's allocator is routed here by RawDatabase, and
+video frame buffers are accounted by the video sources and VideoFrame.
+Other malloc'd memory, such as the buffers of QString, QByteArray and QImage
+or OpenAL's sample buffers, isn't tracked, so the counters remain a lower bound.
+
+Hot paths open an ALLOC_SCOPE, which tags allocations made on the current
+thread until the scope ends. Scopes nest, the innermost one wins, and anything
+outside a scope is counted as Other. Without the build flag the macro expands
+to nothing and the counters stay empty.
+
+@class AllocStats::Scope
+@brief Tags allocations made on this thread with a subsystem while it lives.
+*/
+
+static const char* subsystemNames[AllocStats::SubsystemCount] =
+{
+    "other", "chatlog", "persistence", "video", "core", "widgets"
+};
+
+// Snapshot times are relative to this, taken during static initialization
+static const qint64 startMsecs = QDateTime::currentMSecsSinceEpoch();
+
+#ifdef QTOX_ALLOC_PROFILING
+
+// Plain zero-initialized storage, usable before any constructor runs
+static std::atomic<qint64> liveBytes[AllocStats::SubsystemCount];
+static std::atomic<qint64> allocCalls[AllocStats::SubsystemCount];
+static std::atomic<qint64> allocBytes[AllocStats::SubsystemCount];
+static thread_local int currentSubsystem = AllocStats::Other;
+
+namespace
+{
+struct alignas(std::max_align_t) BlockHeader
+{
+    size_t size;
+    int subsystem;
+};
+}
+
+static void* trackedAlloc(size_t size)
+{
+    void* block = std::malloc(sizeof(BlockHeader) + size);
+    if (!block)
+        return nullptr;
+
+    BlockHeader* header = static_cast<BlockHeader*>(block);
+    header->size = size;
+    header->subsystem = currentSubsystem;
+    liveBytes[header->subsystem].fetch_add(size, std::memory_order_relaxed);
+    allocCalls[header->subsystem].fetch_add(1, std::memory_order_relaxed);
+    allocBytes[header->subsystem].fetch_add(size, std::memory_order_relaxed);
+    return header + 1;
+}
+
+static void trackedFree(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+    liveBytes[header->subsystem].fetch_sub(header->size, std::memory_order_relaxed);
+    std::free(header);
+}
+
+static void* throwingAlloc(size_t size)
+{
+    for (;;)
+    {
+        if (void* ptr = trackedAlloc(size))
+            return ptr;
+
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+
+        handler();
+    }
+}
+
+void* operator new(size_t size)
+{
+    return throwingAlloc(size);
+}
+
+void* operator new[](size_t size)
+{
+    return throwingAlloc(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return trackedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return trackedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    trackedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    trackedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    trackedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    trackedFree(ptr);
+}
+
+AllocStats::Scope::Scope(Subsystem subsystem)
+    : previous{currentSubsystem}
+{
+    currentSubsystem = subsystem;
+}
+
+AllocStats::Scope::~Scope()
+{
+    currentSubsystem = previous;
+}
+
+#else
+
+AllocStats::Scope::Scope(Subsystem)
+    : previous{Other}
+{
+}
+
+AllocStats::Scope::~Scope()
+{
+}
+
+#endif
+
+/**
+@brief Accounts memory that wasn't allocated with operator new.
+@param subsystem Subsystem owning the memory.
+@param bytes Size of the allocation.
+*/
+void AllocStats::allocated(Subsystem subsystem, qint64 bytes)
+{
+#ifdef QTOX_ALLOC_PROFILING
+    liveBytes[subsystem].fetch_add(bytes, std::memory_order_relaxed);
+    allocCalls[subsystem].fetch_add(1, std::memory_order_relaxed);
+    allocBytes[subsystem].fetch_add(bytes, std::memory_order_relaxed);
+#else
+    Q_UNUSED(subsystem);
+    Q_UNUSED(bytes);
+#endif
+}
+
+/**
+@brief Releases memory accounted with allocated().
+@param subsystem Subsystem the memory was accounted to.
+@param bytes Size of the allocation.
+*/
+void AllocStats::freed(Subsystem subsystem, qint64 bytes)
+{
+#ifdef QTOX_ALLOC_PROFILING
+    liveBytes[subsystem].fetch_sub(bytes, std::memory_order_relaxed);
+#else
+    Q_UNUSED(subsystem);
+    Q_UNUSED(bytes);
+#endif
+}
+
+/**
+@brief Checks if this build accounts allocations.
+@return True if built with QTOX_ALLOC_PROFILING.
+*/
+bool AllocStats::isEnabled()
+{
+#ifdef QTOX_ALLOC_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+@brief Reads the counters of every subsystem.
+@return The counters and the time they were read at, in ms since startup.
+*/
+AllocStats::Snapshot AllocStats::snapshot()
+{
+    Snapshot snap;
+    snap.msecs = QDateTime::currentMSecsSinceEpoch() - startMsecs;
+    for (int i = 0; i < SubsystemCount; ++i)
+    {
+#ifdef QTOX_ALLOC_PROFILING
+        snap.counters[i] = {liveBytes[i].load(std::memory_order_relaxed),
+                            allocCalls[i].load(std::memory_order_relaxed),
+                            allocBytes[i].load(std::memory_order_relaxed)};
+#else
+        snap.counters[i] = {0, 0, 0};
+#endif
+    }
+
+    return snap;
+}
+
+/**
+@brief Formats the live bytes and allocation rates of every subsystem.
+@param previous Snapshot the rates are computed from, an empty one for rates since startup.
+@return One line per subsystem.
+*/
+QString AllocStats::report(const Snapshot& previous)
+{
+    Snapshot now = snapshot();
+    double secs = qMax<qint64>(now.msecs - previous.msecs, 1) / 1000.0;
+
+    QStringList lines;
+    for (int i = 0; i < SubsystemCount; ++i)
+    {
+        const Counters& cur = now.counters[i];
+        const Counters& prev = previous.counters[i];
+        lines << QString("%1: %2 KiB live, %3 allocs/s, %4 KiB/s")
+                 .arg(QString::fromLatin1(subsystemNames[i]), -12)
+                 .arg(cur.liveBytes / 1024)
+                 .arg((cur.allocCalls - prev.allocCalls) / secs, 0, 'f', 0)
+                 .arg((cur.allocBytes - prev.allocBytes) / 1024 / secs, 0, 'f', 1);
+    }
+
+    return lines.join('\n');
+}
+
+/**
+@brief Logs the counters of every subsystem, with rates since startup.
+@note Untracked malloc'd memory, such as Qt containers' buffers, isn't included.
+*/
+void AllocStats::dump()
+{
+    if (!isEnabled())
+    {
+        qDebug() << "Allocation accounting is not built in, configure with ENABLE_ALLOC_PROFILING=YES";
+        return;
+    }
+
+    Snapshot start{};
+    qDebug() << "Tracked memory per subsystem:";
+    for (const QString& line : report(start).split('\n'))
+        qDebug().noquote() << line;
+}
@@ -0,0 +1,81 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+#include <QString>
+#include <QtGlobal>
+
+namespace AllocStats
+{
+    enum Subsystem
+    {
+        Other,
+        ChatLog,
+        Persistence,
+        Video,
+        Core,
+        Widgets,
+        SubsystemCount
+    };
+
+    struct Counters
+    {
+        qint64 liveBytes;
+        qint64 allocCalls;
+        qint64 allocBytes;
+    };
+
+    struct Snapshot
+    {
+        qint64 msecs;
+        Counters counters[SubsystemCount];
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope(Subsystem subsystem);
+        ~Scope();
+
+    private:
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        int previous;
+    };
+
+    void allocated(Subsystem subsystem, qint64 bytes);
+    void freed(Subsystem subsystem, qint64 bytes);
+
+    bool isEnabled();
+    Snapshot snapshot();
+    QString report(const Snapshot& previous);
+    void dump();
+}
+
+#ifdef QTOX_ALLOC_PROFILING
+#define ALLOC_SCOPE(subsystem) AllocStats::Scope allocScope(AllocStats::subsystem)
+#else
+#define ALLOC_SCOPE(subsystem)
+#endif
+
+#endif // ALLOCSTATS_H
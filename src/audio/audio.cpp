@@ -93,19 +93,58 @@ private:
 When there are input subscribers, we regularly emit captured audio frames with this signal
 Always connect with a blocking queued connection lambda, else the behaviour is undefined
 
-@var Audio::AUDIO_SAMPLE_RATE
-@brief The next best Opus would take is 24k
+@fn void Audio::profileChanged()
+@brief Sent when captured frames start using another AudioProfile.
 
-@var Audio::AUDIO_FRAME_DURATION
-@brief In milliseconds
+@var AudioProfile Audio::profile
+@brief Format of the captured frames and bitrate of the calls, guarded by audioLock.
+*/
+
+/**
+@struct AudioProfile
+@brief Capture format and call bitrate, traded between latency and bandwidth.
+
+@var uint32_t AudioProfile::sampleRate
+@brief The next best Opus would take after 48k is 24k
+
+@var uint32_t AudioProfile::frameDuration
+@brief In milliseconds, one of the Opus frame sizes
 
-@var Audio::AUDIO_FRAME_SAMPLE_COUNT
-@brief Frame sample count
+@var uint32_t AudioProfile::channels
+@brief Ideally, we'd auto-detect, but stereo is a sane default
 
-@var Audio::AUDIO_CHANNELS
-@brief Ideally, we'd auto-detect, but that's a sane default
+@var uint32_t AudioProfile::bitrate
+@brief Audio bitrate of calls, in kb/s
 */
 
+/**
+@brief Returns the parameters of a profile.
+@param type One of AudioProfile::Type, unknown values give the balanced profile.
+
+Short frames cut the latency for LAN calls, long mono frames at a low bitrate
+keep calls usable on constrained links, at the cost of some delay.
+*/
+AudioProfile AudioProfile::fromType(int type)
+{
+    switch (type)
+    {
+    case LowLatency:
+        return {LowLatency, 48000, 10, 2, 96};
+    case LowBandwidth:
+        return {LowBandwidth, 24000, 60, 1, 16};
+    default:
+        return {Balanced, 48000, 20, 2, 64};
+    }
+}
+
+/**
+@brief Number of samples per channel in a frame.
+*/
+ALint AudioProfile::frameSampleCount() const
+{
+    return frameDuration * sampleRate / 1000;
+}
+
 /**
 @brief Returns the singleton instance.
 */
@@ -125,6 +164,7 @@ Audio::Audio()
     , alMainSource{0}
     , alMainBuffer{0}
     , outputInitialized{false}
+    , profile(AudioProfile::fromType(Settings::getInstance().getAudioProfile()))
 {
     // initialize OpenAL error stack
     alGetError();
@@ -136,7 +176,7 @@ Audio::Audio()
     moveToThread(audioThread);
 
     connect(&captureTimer, &QTimer::timeout, this, &Audio::doCapture);
-    captureTimer.setInterval(AUDIO_FRAME_DURATION/2);
+    captureTimer.setInterval(profile.frameDuration/2);
     captureTimer.setSingleShot(false);
     captureTimer.start();
     connect(&playMono16Timer, &QTimer::timeout, this, &Audio::playMono16SoundCleanup);
@@ -265,6 +305,40 @@ void Audio::setInputGain(qreal dB)
     d->setInputGain(dB);
 }
 
+/**
+@brief Returns the profile used for capture and calls.
+*/
+AudioProfile Audio::getProfile() const
+{
+    QMutexLocker locker(&audioLock);
+    return profile;
+}
+
+/**
+@brief Switches capture and calls to another profile.
+@param type One of AudioProfile::Type.
+
+The input device is reopened with the new format, calls pick up the new bitrate.
+*/
+void Audio::setProfile(int type)
+{
+    {
+        QMutexLocker locker(&audioLock);
+        AudioProfile newProfile = AudioProfile::fromType(type);
+        if (newProfile.type == profile.type)
+            return;
+
+        profile = newProfile;
+        if (alInDev)
+        {
+            cleanupInput();
+            initInput(Settings::getInstance().getInDev());
+        }
+    }
+
+    emit profileChanged();
+}
+
 void Audio::reinitInput(const QString& inDevDesc)
 {
     QMutexLocker locker(&audioLock);
@@ -346,10 +420,10 @@ bool Audio::initInput(const QString& deviceName)
     assert(!alInDev);
 
     /// TODO: Try to actually detect if our audio source is stereo
-    int stereoFlag = AUDIO_CHANNELS == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
-    const uint32_t sampleRate = AUDIO_SAMPLE_RATE;
-    const uint16_t frameDuration = AUDIO_FRAME_DURATION;
-    const uint32_t chnls = AUDIO_CHANNELS;
+    int stereoFlag = profile.channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+    const uint32_t sampleRate = profile.sampleRate;
+    const uint16_t frameDuration = profile.frameDuration;
+    const uint32_t chnls = profile.channels;
     const ALCsizei bufSize = (frameDuration * sampleRate * 4) / 1000 * chnls;
 
     const ALchar* tmpDevName = deviceName.isEmpty()
@@ -577,18 +651,28 @@ void Audio::doCapture()
 {
     QMutexLocker lock(&audioLock);
 
+    // Timers can only be touched from their own thread, so follow profile changes here
+    int interval = profile.frameDuration / 2;
+    if (captureTimer.interval() != interval)
+        captureTimer.setInterval(interval);
+
     if (!alInDev || !inSubscriptions)
         return;
 
+    const ALint frameSamples = profile.frameSampleCount();
     ALint curSamples = 0;
     alcGetIntegerv(alInDev, ALC_CAPTURE_SAMPLES, sizeof(curSamples), &curSamples);
-    if (curSamples < AUDIO_FRAME_SAMPLE_COUNT)
+    if (curSamples < frameSamples)
         return;
 
-    int16_t buf[AUDIO_FRAME_SAMPLE_COUNT * AUDIO_CHANNELS];
-    alcCaptureSamples(alInDev, buf, AUDIO_FRAME_SAMPLE_COUNT);
+    const int bufSize = frameSamples * profile.channels;
+    if (captureBuffer.size() != bufSize)
+        captureBuffer.resize(bufSize);
+
+    int16_t* buf = captureBuffer.data();
+    alcCaptureSamples(alInDev, buf, frameSamples);
 
-    for (quint32 i = 0; i < AUDIO_FRAME_SAMPLE_COUNT * AUDIO_CHANNELS; ++i)
+    for (int i = 0; i < bufSize; ++i)
     {
         // gain amplification with clipping to 16-bit boundaries
         int ampPCM = qBound<int>(std::numeric_limits<int16_t>::min(),
@@ -598,7 +682,7 @@ void Audio::doCapture()
         buf[i] = static_cast<int16_t>(ampPCM);
     }
 
-    emit frameAvailable(buf, AUDIO_FRAME_SAMPLE_COUNT, AUDIO_CHANNELS, AUDIO_SAMPLE_RATE);
+    emit frameAvailable(buf, frameSamples, profile.channels, profile.sampleRate);
 }
 
 /**
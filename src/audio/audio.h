@@ -27,6 +27,7 @@
 #include <QObject>
 #include <QMutex>
 #include <QTimer>
+#include <QVector>
 
 #if defined(__APPLE__) && defined(__MACH__)
  #include <OpenAL/al.h>
@@ -42,6 +43,25 @@
 #include <AL/alext.h>
 #endif
 
+struct AudioProfile
+{
+    enum Type
+    {
+        Balanced = 0,
+        LowLatency,
+        LowBandwidth
+    };
+
+    static AudioProfile fromType(int type);
+    ALint frameSampleCount() const;
+
+    int type;
+    uint32_t sampleRate;
+    uint32_t frameDuration;
+    uint32_t channels;
+    uint32_t bitrate;
+};
+
 class Audio : public QObject
 {
     Q_OBJECT
@@ -85,16 +105,13 @@ public:
     void playAudioBuffer(ALuint alSource, const int16_t *data, int samples,
                          unsigned channels, int sampleRate);
 
-public:
-    // Public default audio settings
-    static constexpr uint32_t AUDIO_SAMPLE_RATE = 48000;
-    static constexpr uint32_t AUDIO_FRAME_DURATION = 20;
-    static constexpr ALint AUDIO_FRAME_SAMPLE_COUNT = AUDIO_FRAME_DURATION * AUDIO_SAMPLE_RATE/1000;
-    static constexpr uint32_t AUDIO_CHANNELS = 2;
+    AudioProfile getProfile() const;
+    void setProfile(int type);
 
 signals:
     void groupAudioPlayed(int group, int peer, unsigned short volume);
     void frameAvailable(const int16_t *pcm, size_t sample_count, uint8_t channels, uint32_t sampling_rate);
+    void profileChanged();
 
 private:
     Audio();
@@ -122,6 +139,8 @@ private:
     ALCdevice*          alInDev;
     quint32             inSubscriptions;
     QTimer              captureTimer, playMono16Timer;
+    AudioProfile        profile;
+    QVector<int16_t>    captureBuffer;
 
     ALCdevice*          alOutDev;
     ALCcontext*         alOutContext;
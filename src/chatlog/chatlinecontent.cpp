@@ -85,6 +85,11 @@ void ChatLineContent::visibilityChanged(bool)
 
 }
 
+void ChatLineContent::setSearchHighlight(const QString&, bool)
+{
+
+}
+
 QString ChatLineContent::getText() const
 {
     return QString();
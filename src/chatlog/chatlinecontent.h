@@ -54,6 +54,7 @@ public:
     virtual void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) = 0;
 
     virtual void visibilityChanged(bool visible);
+    virtual void setSearchHighlight(const QString& phrase, bool current);
 
 private:
     friend class ChatLine;
@@ -21,6 +21,7 @@
 #include "chatmessage.h"
 #include "chatlinecontent.h"
 #include "src/widget/translator.h"
+#include "src/allocstats.h"
 
 #include <QDebug>
 #include <QScrollBar>
@@ -30,12 +31,74 @@
 #include <QTimer>
 #include <QMouseEvent>
 #include <QShortcut>
+#include <QFutureWatcher>
+#include <QSet>
+#include <QtConcurrent/QtConcurrentRun>
 
 /**
 @var ChatLog::repNameAfter
 @brief repetition interval sender name (sec)
+
+@var QList<ChatLine::Ptr> ChatLog::visibleLines
+@brief Lines intersecting the viewport, sorted by row.
+
+@var QList<ChatLine::Ptr> ChatLog::retainedLines
+@brief Lines whose content is currently generated, visible or not.
+
+@var ChatLog::prefetchScrollDir
+@brief Direction of the last scroll, in which documents are prefetched.
+
+@var QVector<QString> ChatLog::searchIndex
+@brief Lower-cased searchable text of each line, indexed by row.
+
+@var QVector<ChatLine::Ptr> ChatLog::searchCandidates
+@brief Lines being searched by the running search, in the order given to the worker.
+
+@var QVector<ChatLine::Ptr> ChatLog::searchMatches
+@brief Lines matching the search phrase, sorted by row.
+
+@var bool ChatLog::searchPending
+@brief True from the start of a search until its result is handled.
+
+The watcher stops running before onSearchFinished() is called, new lines
+added meanwhile would be lost when the result replaces the matches.
+
+@var ChatLog::pendingMatchDir
+@brief Direction of a jump requested while the search or the layout was busy.
 */
 
+// Lines closer than this many viewport heights to the viewport are generated
+static const qreal retainMargin = 1.0;
+// Generated lines are only freed once further away than this, so that
+// scrolling back and forth around a boundary doesn't regenerate them
+static const qreal releaseMargin = 2.0;
+// Upper bound on the number of generated lines, the farthest are freed first
+static const int maxRetainedLines = 300;
+// Lines prefetched per idle tick, keeps each tick short
+static const int prefetchBatchSize = 10;
+// Lines inserted on top that are laid out right away instead of by the resize worker
+static const int maxDirectTopInsert = 200;
+
+/**
+@brief Finds the texts containing a phrase, runs on a worker thread.
+@param texts Lower-cased texts to search.
+@param phrase Lower-cased phrase to find.
+@param canceled Set when a newer search made this one useless.
+@return Indices of the matching texts, in ascending order.
+*/
+static QVector<int> findSearchMatches(QVector<QString> texts, QString phrase,
+                                      std::shared_ptr<std::atomic_bool> canceled)
+{
+    QVector<int> matches;
+    for (int i = 0; i < texts.size() && !*canceled; ++i)
+    {
+        if (texts[i].contains(phrase))
+            matches.append(i);
+    }
+
+    return matches;
+}
+
 template<class T>
 T clamp(T x, T min, T max)
 {
@@ -114,6 +177,16 @@ ChatLog::ChatLog(QWidget* parent)
     workerTimer->setInterval(5);
     connect(workerTimer, &QTimer::timeout, this, &ChatLog::onWorkerTimeout);
 
+    // Prefetches the documents of the lines ahead once scrolling pauses
+    prefetchTimer = new QTimer(this);
+    prefetchTimer->setSingleShot(true);
+    prefetchTimer->setInterval(50);
+    connect(prefetchTimer, &QTimer::timeout, this, &ChatLog::onPrefetchTimeout);
+
+    // Searches the loaded lines off the GUI thread
+    searchWatcher = new QFutureWatcher<QVector<int>>(this);
+    connect(searchWatcher, &QFutureWatcher<QVector<int>>::finished, this, &ChatLog::onSearchFinished);
+
     // selection
     connect(this, &ChatLog::selectionChanged, this, [this]() {
         copyAction->setEnabled(hasTextToBeCopied());
@@ -369,6 +442,8 @@ void ChatLog::reposition(int start, int end, qreal deltaY)
 
 void ChatLog::insertChatlineAtBottom(ChatLine::Ptr l)
 {
+    ALLOC_SCOPE(ChatLog);
+
     if (!l.get())
         return;
 
@@ -378,6 +453,7 @@ void ChatLog::insertChatlineAtBottom(ChatLine::Ptr l)
     l->setRow(lines.size());
     l->addToScene(scene);
     lines.append(l);
+    searchIndex.append(searchableText(l));
 
     //partial refresh
     layout(lines.last()->getRow(), lines.size(), useableWidth());
@@ -388,6 +464,23 @@ void ChatLog::insertChatlineAtBottom(ChatLine::Ptr l)
 
     checkVisibility();
     updateTypingNotification();
+
+    if (searchPhrase.isEmpty())
+        return;
+
+    // the running search doesn't know about this line
+    if (searchPending)
+    {
+        restartSearch();
+    }
+    else if (searchIndex.last().contains(searchPhrase))
+    {
+        searchMatches.append(l);
+        if (ChatLineContent* content = l->getContent(1))
+            content->setSearchHighlight(searchPhrase, false);
+
+        emit searchFinished(searchMatches.size());
+    }
 }
 
 void ChatLog::insertChatlineOnTop(ChatLine::Ptr l)
@@ -400,15 +493,24 @@ void ChatLog::insertChatlineOnTop(ChatLine::Ptr l)
 
 void ChatLog::insertChatlineOnTop(const QList<ChatLine::Ptr>& newLines)
 {
+    ALLOC_SCOPE(ChatLog);
+
     if (newLines.isEmpty())
         return;
 
     QGraphicsScene::ItemIndexMethod oldIndexMeth = scene->itemIndexMethod();
     scene->setItemIndexMethod(QGraphicsScene::NoIndex);
 
+    // a small batch above laid out lines doesn't need the resize worker,
+    // the old lines just move down and the view follows them
+    bool layoutDirectly = !lines.isEmpty() && !workerTimer->isActive()
+                          && newLines.size() <= maxDirectTopInsert;
+
     // alloc space for old and new lines
     QVector<ChatLine::Ptr> combLines;
     combLines.reserve(newLines.size() + lines.size());
+    QVector<QString> combIndex;
+    combIndex.reserve(newLines.size() + lines.size());
 
     // add the new lines
     int i = 0;
@@ -418,6 +520,7 @@ void ChatLog::insertChatlineOnTop(const QList<ChatLine::Ptr>& newLines)
         l->visibilityChanged(false);
         l->setRow(i++);
         combLines.push_back(l);
+        combIndex.push_back(searchableText(l));
     }
 
     // add the old lines
@@ -428,11 +531,35 @@ void ChatLog::insertChatlineOnTop(const QList<ChatLine::Ptr>& newLines)
     }
 
     lines = combLines;
+    combIndex += searchIndex;
+    searchIndex = combIndex;
 
     scene->setItemIndexMethod(oldIndexMeth);
 
-    // redo layout
-    startResizeWorker();
+    if (layoutDirectly)
+    {
+        int newCount = newLines.size();
+        layout(0, newCount - 1, useableWidth());
+
+        qreal delta = lines[newCount - 1]->sceneBoundingRect().bottom() + lineSpacing
+                      - lines[newCount]->sceneBoundingRect().top();
+        for (int j = newCount; j < lines.size(); ++j)
+            lines[j]->moveBy(delta);
+
+        updateSceneRect();
+        updateTypingNotification();
+        updateMultiSelectionRect();
+        verticalScrollBar()->setValue(verticalScrollBar()->value() + qRound(delta));
+        checkVisibility();
+    }
+    else
+    {
+        // redo layout
+        startResizeWorker();
+    }
+
+    if (!searchPhrase.isEmpty())
+        restartSearch();
 }
 
 bool ChatLog::stickToBottom() const
@@ -565,6 +692,15 @@ void ChatLog::clear()
 
     lines.clear();
     visibleLines.clear();
+    retainedLines.clear();
+    searchIndex.clear();
+    searchMatches.clear();
+    currentMatch.reset();
+
+    if (!searchPhrase.isEmpty())
+        restartSearch();
+    prefetchTimer->stop();
+    prefetchScrollDir = NoDirection;
 
     updateSceneRect();
 }
@@ -635,6 +771,213 @@ void ChatLog::forceRelayout()
     startResizeWorker();
 }
 
+/**
+@brief Searches the loaded lines for a phrase, without blocking.
+@param phrase Phrase to find, case insensitive. An empty phrase stops the search.
+
+Emits searchFinished once the matches are known and highlighted. When the phrase
+extends the previous one, only the previous matches are searched again.
+*/
+void ChatLog::startSearch(const QString& phrase)
+{
+    QString lowerPhrase = phrase.toLower();
+    if (lowerPhrase.isEmpty())
+    {
+        stopSearch();
+        return;
+    }
+
+    // a phrase containing the previous one can only match lines the previous one did
+    bool refine = !searchPhrase.isEmpty() && lowerPhrase.contains(searchPhrase)
+                  && !searchPending;
+
+    if (searchCanceled)
+        *searchCanceled = true;
+
+    searchCanceled = std::make_shared<std::atomic_bool>(false);
+    searchPhrase = lowerPhrase;
+
+    QVector<QString> texts;
+    if (refine)
+    {
+        searchCandidates = searchMatches;
+        texts.reserve(searchCandidates.size());
+        for (const ChatLine::Ptr& line : searchCandidates)
+            texts.append(searchIndex[line->getRow()]);
+    }
+    else
+    {
+        searchCandidates = lines;
+        texts = searchIndex;
+    }
+
+    searchPending = true;
+    searchWatcher->setFuture(QtConcurrent::run(findSearchMatches, texts, searchPhrase, searchCanceled));
+}
+
+/**
+@brief Stops searching and removes the highlights.
+*/
+void ChatLog::stopSearch()
+{
+    if (searchCanceled)
+        *searchCanceled = true;
+
+    searchPhrase.clear();
+    searchCandidates.clear();
+    searchPending = false;
+    pendingMatchDir = NoDirection;
+    setSearchMatches({});
+}
+
+/**
+@brief Jumps to the closest match above the current one, or to the last match.
+@return False if there is no such match among the loaded lines.
+*/
+bool ChatLog::findPrevious()
+{
+    if (searchPhrase.isEmpty())
+        return false;
+
+    if (searchPending || workerTimer->isActive())
+    {
+        pendingMatchDir = Up;
+        return true;
+    }
+
+    ChatLine::Ptr match;
+    if (!currentMatch)
+    {
+        if (!searchMatches.isEmpty())
+            match = searchMatches.last();
+    }
+    else
+    {
+        auto itr = std::lower_bound(searchMatches.cbegin(), searchMatches.cend(), currentMatch, ChatLine::lessThanRowIndex);
+        if (itr != searchMatches.cbegin())
+            match = *(itr - 1);
+    }
+
+    if (!match)
+        return false;
+
+    setCurrentMatch(match);
+    return true;
+}
+
+/**
+@brief Jumps to the closest match below the current one.
+@return False if there is no such match.
+*/
+bool ChatLog::findNext()
+{
+    if (searchPhrase.isEmpty())
+        return false;
+
+    if (searchPending || workerTimer->isActive())
+    {
+        pendingMatchDir = Down;
+        return true;
+    }
+
+    if (!currentMatch)
+        return false;
+
+    auto itr = std::upper_bound(searchMatches.cbegin(), searchMatches.cend(), currentMatch, ChatLine::lessThanRowIndex);
+    if (itr == searchMatches.cend())
+        return false;
+
+    setCurrentMatch(*itr);
+    return true;
+}
+
+/**
+@brief Replaces the matches, updating the highlights of the lines that changed.
+*/
+void ChatLog::setSearchMatches(const QVector<ChatLine::Ptr>& matches)
+{
+    QSet<ChatLine*> matched;
+    for (const ChatLine::Ptr& line : matches)
+        matched.insert(line.get());
+
+    for (const ChatLine::Ptr& line : searchMatches)
+    {
+        ChatLineContent* content = line->getContent(1);
+        if (content && !matched.contains(line.get()))
+            content->setSearchHighlight(QString(), false);
+    }
+
+    if (currentMatch && !matched.contains(currentMatch.get()))
+        currentMatch.reset();
+
+    searchMatches = matches;
+
+    for (const ChatLine::Ptr& line : searchMatches)
+    {
+        if (ChatLineContent* content = line->getContent(1))
+            content->setSearchHighlight(searchPhrase, line == currentMatch);
+    }
+}
+
+/**
+@brief Marks a match as the current one and scrolls it to the middle of the view.
+
+Only the scroll position changes, the lines keep their layout.
+*/
+void ChatLog::setCurrentMatch(ChatLine::Ptr match)
+{
+    if (currentMatch)
+    {
+        if (ChatLineContent* content = currentMatch->getContent(1))
+            content->setSearchHighlight(searchPhrase, false);
+    }
+
+    currentMatch = match;
+
+    if (ChatLineContent* content = currentMatch->getContent(1))
+        content->setSearchHighlight(searchPhrase, true);
+
+    updateSceneRect();
+    qreal center = currentMatch->sceneBoundingRect().center().y();
+    verticalScrollBar()->setValue(qRound(center - viewport()->height() / 2.0));
+}
+
+/**
+@brief Performs the jump requested while busy, once the search and the layout are done.
+*/
+void ChatLog::jumpToPendingMatch()
+{
+    if (pendingMatchDir == NoDirection || searchPending || workerTimer->isActive())
+        return;
+
+    AutoScrollDirection dir = pendingMatchDir;
+    pendingMatchDir = NoDirection;
+
+    if (dir == Up)
+        findPrevious();
+    else
+        findNext();
+}
+
+/**
+@brief Searches all the lines again, after lines were added or removed under a running search.
+*/
+void ChatLog::restartSearch()
+{
+    QString phrase = searchPhrase;
+    searchPhrase.clear();
+    startSearch(phrase);
+}
+
+/**
+@brief Text of a line the search looks at, lower-cased.
+*/
+QString ChatLog::searchableText(const ChatLine::Ptr& line)
+{
+    ChatLineContent* content = line->getContent(1);
+    return content ? content->getText().toLower() : QString();
+}
+
 void ChatLog::checkVisibility()
 {
     if (lines.empty())
@@ -646,35 +989,86 @@ void ChatLog::checkVisibility()
     // find last visible line
     auto upperBound = std::lower_bound(lowerBound, lines.cend(), getVisibleRect().bottom(), ChatLine::lessThanBSRectTop);
 
-    // set visibilty
-    QList<ChatLine::Ptr> newVisibleLines;
+    visibleLines.clear();
     for (auto itr = lowerBound; itr != upperBound; ++itr)
-    {
-        newVisibleLines.append(*itr);
+        visibleLines.append(*itr);
 
-        if (!visibleLines.contains(*itr))
-            (*itr)->visibilityChanged(true);
+    // enforce order
+    std::sort(visibleLines.begin(), visibleLines.end(), ChatLine::lessThanRowIndex);
+
+    updateRetainedLines();
+
+    //if (!visibleLines.empty())
+    //  qDebug() << "visible from " << visibleLines.first()->getRow() << "to " << visibleLines.last()->getRow() << " total " << visibleLines.size();
+}
 
-        visibleLines.removeOne(*itr);
+/**
+@brief Generates the lines around the viewport and frees the ones far away from it.
+
+Lines within retainMargin viewport heights are generated, but only freed once they're
+further away than releaseMargin. If more than maxRetainedLines are generated,
+the ones farthest from the viewport are freed first.
+*/
+void ChatLog::updateRetainedLines()
+{
+    QRect visible = getVisibleRect();
+    qreal height = visible.height();
+    qreal releaseTop = visible.top() - height * releaseMargin;
+    qreal releaseBottom = visible.bottom() + height * releaseMargin;
+
+    // free the lines that left the release window
+    for (auto itr = retainedLines.begin(); itr != retainedLines.end();)
+    {
+        QRectF rect = (*itr)->sceneBoundingRect();
+        if (rect.bottom() < releaseTop || rect.top() > releaseBottom)
+        {
+            (*itr)->visibilityChanged(false);
+            itr = retainedLines.erase(itr);
+        }
+        else
+        {
+            ++itr;
+        }
     }
 
-    // these lines are no longer visible
-    for (ChatLine::Ptr line : visibleLines)
-        line->visibilityChanged(false);
+    // generate the lines close to the viewport
+    auto lowerBound = std::lower_bound(lines.cbegin(), lines.cend(), visible.top() - height * retainMargin, ChatLine::lessThanBSRectBottom);
+    auto upperBound = std::lower_bound(lowerBound, lines.cend(), visible.bottom() + height * retainMargin, ChatLine::lessThanBSRectTop);
 
-    visibleLines = newVisibleLines;
+    for (auto itr = lowerBound; itr != upperBound; ++itr)
+    {
+        if (!retainedLines.contains(*itr))
+        {
+            (*itr)->visibilityChanged(true);
+            retainedLines.append(*itr);
+        }
+    }
 
-    // enforce order
-    std::sort(visibleLines.begin(), visibleLines.end(), ChatLine::lessThanRowIndex);
+    if (retainedLines.size() <= maxRetainedLines)
+        return;
 
-    //if (!visibleLines.empty())
-    //  qDebug() << "visible from " << visibleLines.first()->getRow() << "to " << visibleLines.last()->getRow() << " total " << visibleLines.size();
+    // over budget, free the lines farthest from the viewport
+    qreal center = visible.center().y();
+    std::sort(retainedLines.begin(), retainedLines.end(), [center](const ChatLine::Ptr& lhs, const ChatLine::Ptr& rhs)
+    {
+        return qAbs(lhs->sceneBoundingRect().center().y() - center) < qAbs(rhs->sceneBoundingRect().center().y() - center);
+    });
+
+    while (retainedLines.size() > maxRetainedLines)
+        retainedLines.takeLast()->visibilityChanged(false);
 }
 
 void ChatLog::scrollContentsBy(int dx, int dy)
 {
     QGraphicsView::scrollContentsBy(dx, dy);
     checkVisibility();
+
+    // content moving up means we're scrolling down
+    if (dy != 0)
+    {
+        prefetchScrollDir = dy < 0 ? Down : Up;
+        prefetchTimer->start();
+    }
 }
 
 void ChatLog::resizeEvent(QResizeEvent* ev)
@@ -775,6 +1169,72 @@ void ChatLog::onSelectionTimerTimeout()
     }
 }
 
+/**
+@brief Generates a few lines ahead of the viewport, in the direction of the last scroll.
+
+Runs once scrolling pauses and reschedules itself until the lines between the retain
+and release margins are generated, so that they're ready once they're scrolled into view.
+*/
+void ChatLog::onPrefetchTimeout()
+{
+    if (lines.empty() || prefetchScrollDir == NoDirection || retainedLines.size() >= maxRetainedLines)
+        return;
+
+    QRect visible = getVisibleRect();
+    qreal height = visible.height();
+    qreal top, bottom;
+
+    if (prefetchScrollDir == Down)
+    {
+        top = visible.bottom() + height * retainMargin;
+        bottom = visible.bottom() + height * releaseMargin;
+    }
+    else
+    {
+        top = visible.top() - height * releaseMargin;
+        bottom = visible.top() - height * retainMargin;
+    }
+
+    auto lowerBound = std::lower_bound(lines.cbegin(), lines.cend(), top, ChatLine::lessThanBSRectBottom);
+    auto upperBound = std::lower_bound(lowerBound, lines.cend(), bottom, ChatLine::lessThanBSRectTop);
+
+    QList<ChatLine::Ptr> ahead;
+    for (auto itr = lowerBound; itr != upperBound; ++itr)
+        if (!retainedLines.contains(*itr))
+            ahead.append(*itr);
+
+    // closest to the viewport first
+    if (prefetchScrollDir == Up)
+        std::reverse(ahead.begin(), ahead.end());
+
+    int count = qMin(ahead.size(), qMin(prefetchBatchSize, maxRetainedLines - retainedLines.size()));
+    for (int i = 0; i < count; ++i)
+    {
+        ahead[i]->visibilityChanged(true);
+        retainedLines.append(ahead[i]);
+    }
+
+    if (count < ahead.size())
+        prefetchTimer->start();
+}
+
+void ChatLog::onSearchFinished()
+{
+    searchPending = false;
+    if (searchPhrase.isEmpty())
+        return;
+
+    QVector<ChatLine::Ptr> matches;
+    for (int i : searchWatcher->result())
+        matches.append(searchCandidates[i]);
+
+    searchCandidates.clear();
+    setSearchMatches(matches);
+    emit searchFinished(searchMatches.size());
+
+    jumpToPendingMatch();
+}
+
 void ChatLog::onWorkerTimeout()
 {
     // Fairly arbitrary but
@@ -809,6 +1269,8 @@ void ChatLog::onWorkerTimeout()
 
         // hidden during busy screen
         verticalScrollBar()->show();
+
+        jumpToPendingMatch();
     }
 }
 
@@ -23,6 +23,8 @@
 #include <QGraphicsView>
 #include <QDateTime>
 #include <QMargins>
+#include <atomic>
+#include <memory>
 
 #include "chatline.h"
 #include "chatmessage.h"
@@ -31,6 +33,7 @@ class QGraphicsScene;
 class QGraphicsRectItem;
 class QMouseEvent;
 class QTimer;
+template <typename T> class QFutureWatcher;
 class ChatLineContent;
 struct ToxFile;
 
@@ -53,6 +56,10 @@ public:
     void scrollToLine(ChatLine::Ptr line);
     void selectAll();
     void forceRelayout();
+    void startSearch(const QString& phrase);
+    void stopSearch();
+    bool findPrevious();
+    bool findNext();
 
     QString getSelectedText() const;
 
@@ -66,6 +73,7 @@ public:
 
 signals:
     void selectionChanged();
+    void searchFinished(int matchCount);
 
 protected:
     QRectF calculateSceneRect() const;
@@ -103,9 +111,17 @@ protected:
 private slots:
     void onSelectionTimerTimeout();
     void onWorkerTimeout();
+    void onPrefetchTimeout();
+    void onSearchFinished();
 
 private:
     void retranslateUi();
+    void updateRetainedLines();
+    void setSearchMatches(const QVector<ChatLine::Ptr>& matches);
+    void setCurrentMatch(ChatLine::Ptr match);
+    void jumpToPendingMatch();
+    void restartSearch();
+    static QString searchableText(const ChatLine::Ptr& line);
 
 private:
     enum SelectionMode {
@@ -126,6 +142,7 @@ private:
     QGraphicsScene* busyScene = nullptr;
     QVector<ChatLine::Ptr> lines;
     QList<ChatLine::Ptr> visibleLines;
+    QList<ChatLine::Ptr> retainedLines;
     ChatLine::Ptr typingNotification;
     ChatLine::Ptr busyNotification;
 
@@ -140,7 +157,20 @@ private:
     QGraphicsRectItem* selGraphItem = nullptr;
     QTimer* selectionTimer = nullptr;
     QTimer* workerTimer = nullptr;
+    QTimer* prefetchTimer = nullptr;
     AutoScrollDirection selectionScrollDir = NoDirection;
+    AutoScrollDirection prefetchScrollDir = NoDirection;
+
+    // search
+    QVector<QString> searchIndex;
+    QString searchPhrase;
+    QVector<ChatLine::Ptr> searchCandidates;
+    QVector<ChatLine::Ptr> searchMatches;
+    ChatLine::Ptr currentMatch;
+    QFutureWatcher<QVector<int>>* searchWatcher = nullptr;
+    bool searchPending = false;
+    std::shared_ptr<std::atomic_bool> searchCanceled;
+    AutoScrollDirection pendingMatchDir = NoDirection;
 
     //worker vars
     int workerLastIndex = 0;
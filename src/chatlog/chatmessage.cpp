@@ -20,6 +20,7 @@
 #include "chatmessage.h"
 #include "chatlinecontentproxy.h"
 #include "content/text.h"
+#include "content/statictext.h"
 #include "content/timestamp.h"
 #include "content/spinner.h"
 #include "content/filetransferwidget.h"
@@ -30,6 +31,7 @@
 
 #include "src/persistence/settings.h"
 #include "src/persistence/smileypack.h"
+#include "src/allocstats.h"
 
 #define NAME_COL_WIDTH 90.0
 #define TIME_COL_WIDTH 90.0
@@ -41,6 +43,8 @@ ChatMessage::ChatMessage()
 
 ChatMessage::Ptr ChatMessage::createChatMessage(const QString &sender, const QString &rawMessage, MessageType type, bool isMe, const QDateTime &date)
 {
+    ALLOC_SCOPE(ChatLog);
+
     ChatMessage::Ptr msg = ChatMessage::Ptr(new ChatMessage);
 
     QString text = rawMessage.toHtmlEscaped();
@@ -80,7 +84,7 @@ ChatMessage::Ptr ChatMessage::createChatMessage(const QString &sender, const QSt
     if (isMe)
         authorFont.setBold(true);
 
-    msg->addColumn(new Text(senderText, authorFont, true, sender, type == ACTION ? actionColor : Qt::black), ColumnFormat(NAME_COL_WIDTH, ColumnFormat::FixedSize, ColumnFormat::Right));
+    msg->addColumn(new StaticText(senderText, authorFont, true, sender, type == ACTION ? actionColor : Qt::black), ColumnFormat(NAME_COL_WIDTH, ColumnFormat::FixedSize, ColumnFormat::Right));
     msg->addColumn(new Text(text, baseFont, false, ((type == ACTION) && isMe) ? QString("%1 %2").arg(sender, rawMessage) : rawMessage), ColumnFormat(1.0, ColumnFormat::VariableSize));
     msg->addColumn(new Spinner(":/ui/chatArea/spinner.svg", QSize(16, 16), 360.0/1.6), ColumnFormat(TIME_COL_WIDTH, ColumnFormat::FixedSize, ColumnFormat::Right));
 
@@ -121,7 +125,7 @@ ChatMessage::Ptr ChatMessage::createFileTransferMessage(const QString& sender, T
     if (isMe)
         authorFont.setBold(true);
 
-    msg->addColumn(new Text(sender, authorFont, true), ColumnFormat(NAME_COL_WIDTH, ColumnFormat::FixedSize, ColumnFormat::Right));
+    msg->addColumn(new StaticText(sender, authorFont, true), ColumnFormat(NAME_COL_WIDTH, ColumnFormat::FixedSize, ColumnFormat::Right));
     msg->addColumn(new ChatLineContentProxy(new FileTransferWidget(0, file), 320, 0.6f), ColumnFormat(1.0, ColumnFormat::VariableSize));
     msg->addColumn(new Timestamp(date, Settings::getInstance().getTimestampFormat(), baseFont), ColumnFormat(TIME_COL_WIDTH, ColumnFormat::FixedSize, ColumnFormat::Right));
 
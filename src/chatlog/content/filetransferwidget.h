@@ -42,6 +42,7 @@ public:
     explicit FileTransferWidget(QWidget *parent, ToxFile file);
     virtual ~FileTransferWidget();
     void autoAcceptTransfer(const QString& path);
+    static QString getHumanReadableSize(qint64 size);
 
 protected slots:
     void onFileTransferInfo(ToxFile file);
@@ -54,7 +55,6 @@ protected slots:
     void fileTransferBrokenUnbroken(ToxFile file, bool broken);
 
 protected:
-    QString getHumanReadableSize(qint64 size);
     void hideWidgets();
     void setupButtons();
     void handleButton(QPushButton* btn);
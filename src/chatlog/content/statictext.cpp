@@ -0,0 +1,243 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "statictext.h"
+
+#include <QCache>
+#include <QFontMetricsF>
+#include <QPainter>
+
+/**
+@class StaticText
+@brief Single-line plain text chat cell, such as a timestamp or a sender name.
+
+Unlike Text, it keeps no QTextDocument around: the line is laid out once into a
+QStaticText, and identical strings in the same font share the prepared glyphs.
+It has no links nor search highlights, use Text for message bodies.
+
+@var QString StaticText::rawText
+@brief Text returned by getText(), used when copying or saving the log.
+
+Like Text, an elided cell shows its raw text rather than its text.
+
+@var QString StaticText::shownText
+@brief Text as drawn, once elided.
+*/
+
+// Matches QTextDocument's default margin, so we line up with Text cells
+static const qreal documentMargin = 4.0;
+// Number of distinct laid out strings kept for reuse
+static const int staticTextCacheSize = 1024;
+
+/**
+@brief Returns a prepared QStaticText, shared by all cells showing the same text in the same font.
+*/
+static QStaticText cachedStaticText(const QString& text, const QFont& font)
+{
+    static QCache<QString, QStaticText> cache(staticTextCacheSize);
+
+    const QString key = font.key() + QLatin1Char('\n') + text;
+    if (QStaticText* cached = cache.object(key))
+        return *cached;
+
+    QStaticText staticText(text);
+    staticText.setTextFormat(Qt::PlainText);
+    staticText.setPerformanceHint(QStaticText::AggressiveCaching);
+    staticText.prepare(QTransform(), font);
+
+    cache.insert(key, new QStaticText(staticText));
+    return staticText;
+}
+
+StaticText::StaticText(const QString& txt, const QFont& font, bool enableElide, const QString& rawText, const QColor& c)
+    : text(txt)
+    , rawText(rawText)
+    , font(font)
+    , color(c)
+    , elide(enableElide)
+{
+    layoutText();
+}
+
+void StaticText::setWidth(qreal w)
+{
+    if (w == width)
+        return;
+
+    width = w;
+    layoutText();
+}
+
+QRectF StaticText::boundingRect() const
+{
+    return QRectF(QPointF(0, 0), size);
+}
+
+void StaticText::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    painter->setClipRect(boundingRect());
+    painter->setFont(font);
+    painter->setPen(color);
+    painter->drawStaticText(QPointF(documentMargin, documentMargin), staticText);
+
+    if (hasSelection() && getSelectionStart() < getSelectionEnd())
+    {
+        // draw the selected part again, over its highlight
+        QRectF selection(cursorX(getSelectionStart()), 0,
+                         cursorX(getSelectionEnd()) - cursorX(getSelectionStart()), size.height());
+        const QColor selectionColor = QColor::fromRgbF(0.23, 0.68, 0.91);
+        painter->setClipRect(selection.intersected(boundingRect()));
+        painter->fillRect(selection, selectionColor.lighter(selectionHasFocus ? 100 : 160));
+        painter->setPen(selectionHasFocus ? Qt::white : Qt::black);
+        painter->drawStaticText(QPointF(documentMargin, documentMargin), staticText);
+    }
+
+    Q_UNUSED(option)
+    Q_UNUSED(widget)
+}
+
+qreal StaticText::getAscent() const
+{
+    return ascent;
+}
+
+QString StaticText::getText() const
+{
+    return rawText;
+}
+
+void StaticText::selectionMouseMove(QPointF scenePos)
+{
+    selectionEnd = cursorFromPos(scenePos);
+    update();
+}
+
+void StaticText::selectionStarted(QPointF scenePos)
+{
+    selectionEnd = cursorFromPos(scenePos);
+    selectionAnchor = selectionEnd;
+}
+
+void StaticText::selectionCleared()
+{
+    // Do not reset selectionAnchor!
+    selectionEnd = -1;
+    update();
+}
+
+void StaticText::selectionDoubleClick(QPointF scenePos)
+{
+    int cur = cursorFromPos(scenePos);
+
+    selectionAnchor = cur;
+    while (selectionAnchor > 0 && shownText[selectionAnchor - 1].isLetterOrNumber())
+        --selectionAnchor;
+
+    selectionEnd = cur;
+    while (selectionEnd < shownText.size() && shownText[selectionEnd].isLetterOrNumber())
+        ++selectionEnd;
+
+    update();
+}
+
+void StaticText::selectionFocusChanged(bool focusIn)
+{
+    selectionHasFocus = focusIn;
+    update();
+}
+
+bool StaticText::isOverSelection(QPointF scenePos) const
+{
+    int cur = cursorFromPos(scenePos);
+    return hasSelection() && getSelectionStart() < cur && getSelectionEnd() >= cur;
+}
+
+QString StaticText::getSelectedText() const
+{
+    if (!hasSelection())
+        return QString();
+
+    return shownText.mid(getSelectionStart(), getSelectionEnd() - getSelectionStart());
+}
+
+/**
+@brief Elides the text to the current width if needed, and picks up the shared layout for it.
+*/
+void StaticText::layoutText()
+{
+    QFontMetricsF metrics(font);
+    shownText = text;
+    if (elide)
+        shownText = metrics.elidedText(rawText, Qt::ElideRight, qMax(0.0, width - 2 * documentMargin));
+
+    staticText = cachedStaticText(shownText, font);
+    ascent = metrics.ascent();
+
+    QSizeF newSize(metrics.width(shownText) + 2 * documentMargin,
+                   metrics.height() + 2 * documentMargin);
+    if (width > 0)
+        newSize.setWidth(qMin(newSize.width(), width));
+
+    // let the scene know about our change in size
+    if (newSize != size)
+    {
+        prepareGeometryChange();
+        size = newSize;
+    }
+}
+
+/**
+@brief Finds the character boundary closest to a point.
+@param scenePos Point in scene coordinates.
+@return Position between two characters of the shown text.
+*/
+int StaticText::cursorFromPos(QPointF scenePos) const
+{
+    qreal x = mapFromScene(scenePos).x();
+    int cursor = 0;
+    while (cursor < shownText.size()
+           && (cursorX(cursor) + cursorX(cursor + 1)) / 2 < x)
+        ++cursor;
+
+    return cursor;
+}
+
+/**
+@brief Horizontal position of a character boundary, in item coordinates.
+*/
+qreal StaticText::cursorX(int cursor) const
+{
+    return documentMargin + QFontMetricsF(font).width(shownText.left(cursor));
+}
+
+int StaticText::getSelectionStart() const
+{
+    return qMin(selectionAnchor, selectionEnd);
+}
+
+int StaticText::getSelectionEnd() const
+{
+    return qMax(selectionAnchor, selectionEnd);
+}
+
+bool StaticText::hasSelection() const
+{
+    return selectionEnd >= 0;
+}
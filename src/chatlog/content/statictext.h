@@ -0,0 +1,74 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef STATICTEXT_H
+#define STATICTEXT_H
+
+#include "../chatlinecontent.h"
+
+#include <QColor>
+#include <QFont>
+#include <QStaticText>
+
+class StaticText : public ChatLineContent
+{
+public:
+    StaticText(const QString& txt, const QFont& font, bool enableElide = false, const QString& rawText = QString(), const QColor& c = Qt::black);
+
+    virtual void setWidth(qreal width) final override;
+
+    virtual void selectionMouseMove(QPointF scenePos) final override;
+    virtual void selectionStarted(QPointF scenePos) final override;
+    virtual void selectionCleared() final override;
+    virtual void selectionDoubleClick(QPointF scenePos) final override;
+    virtual void selectionFocusChanged(bool focusIn) final override;
+    virtual bool isOverSelection(QPointF scenePos) const final override;
+    virtual QString getSelectedText() const final override;
+
+    virtual QRectF boundingRect() const final override;
+    virtual void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) final override;
+    virtual qreal getAscent() const final override;
+    virtual QString getText() const final override;
+
+private:
+    void layoutText();
+    int cursorFromPos(QPointF scenePos) const;
+    qreal cursorX(int cursor) const;
+    int getSelectionStart() const;
+    int getSelectionEnd() const;
+    bool hasSelection() const;
+
+private:
+    QString text;
+    QString rawText;
+    QString shownText;
+    QFont font;
+    QColor color;
+    QStaticText staticText;
+    QSizeF size;
+    qreal ascent = 0.0;
+    qreal width = 0.0;
+    bool elide = false;
+    bool selectionHasFocus = true;
+    int selectionEnd = -1;
+    int selectionAnchor = -1;
+};
+
+#endif // STATICTEXT_H
@@ -33,6 +33,19 @@
 
 #include "src/widget/style.h"
 
+#include <algorithm>
+
+/**
+@var QVector<Hotspot> Text::hotspots
+@brief Anchors and tooltips of the document, sorted by position.
+
+Built when the document is regenerated, so that hovering a message only needs
+a single hit test followed by a binary search instead of walking its fragments.
+
+@var QVector<QPair<int, int>> Text::highlights
+@brief Start and end positions of the search matches in the document.
+*/
+
 Text::Text(const QString& txt, const QFont& font, bool enableElide, const QString &rwText, const QColor c)
     : rawText(rwText)
     , elide(enableElide)
@@ -165,6 +178,18 @@ void Text::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWid
             sel.cursor.setPosition(getSelectionEnd(), QTextCursor::KeepAnchor);
         }
 
+        // draw search matches below the selection
+        const QColor highlightColor = highlightCurrent ? QColor(255, 150, 50) : QColor(255, 230, 100);
+        for (const QPair<int, int>& highlight : highlights)
+        {
+            QAbstractTextDocumentLayout::Selection match;
+            match.cursor = QTextCursor(doc);
+            match.cursor.setPosition(highlight.first);
+            match.cursor.setPosition(highlight.second, QTextCursor::KeepAnchor);
+            match.format.setBackground(highlightColor);
+            ctx.selections.append(match);
+        }
+
         const QColor selectionColor = QColor::fromRgbF(0.23, 0.68, 0.91);
         sel.format.setBackground(selectionColor.lighter(selectionHasFocus ? 100 : 160));
         sel.format.setForeground(selectionHasFocus ? Qt::white : Qt::black);
@@ -187,6 +212,25 @@ void Text::visibilityChanged(bool visible)
     update();
 }
 
+/**
+@brief Highlights the occurrences of a phrase.
+@param phrase Phrase to highlight, case insensitive. An empty phrase clears the highlight.
+@param current True if this is the match the user jumped to.
+*/
+void Text::setSearchHighlight(const QString& phrase, bool current)
+{
+    if (highlightPhrase == phrase && highlightCurrent == current)
+        return;
+
+    highlightPhrase = phrase;
+    highlightCurrent = current;
+
+    if (doc)
+        buildHighlights();
+
+    update();
+}
+
 qreal Text::getAscent() const
 {
     return ascent;
@@ -203,11 +247,11 @@ void Text::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     if (!doc)
         return;
 
-    QString anchor = doc->documentLayout()->anchorAt(event->pos());
+    const Hotspot* hotspot = hotspotAt(cursorFromPos(event->scenePos(), false));
 
     // open anchor in browser
-    if (!anchor.isEmpty())
-        QDesktopServices::openUrl(anchor);
+    if (hotspot && !hotspot->anchor.isEmpty())
+        QDesktopServices::openUrl(hotspot->anchor);
 }
 
 void Text::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
@@ -215,15 +259,15 @@ void Text::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
     if (!doc)
         return;
 
-    QString anchor = doc->documentLayout()->anchorAt(event->pos());
+    const Hotspot* hotspot = hotspotAt(cursorFromPos(event->scenePos(), false));
 
-    if (anchor.isEmpty())
-        setCursor(Qt::IBeamCursor);
-    else
+    if (hotspot && !hotspot->anchor.isEmpty())
         setCursor(Qt::PointingHandCursor);
+    else
+        setCursor(Qt::IBeamCursor);
 
     // tooltip
-    setToolTip(extractImgTooltip(cursorFromPos(event->scenePos(), false)));
+    setToolTip(hotspot ? hotspot->tooltip : QString());
 }
 
 QString Text::getText() const
@@ -256,6 +300,9 @@ void Text::regenerate()
             doc->setPlainText(elidedText);
         }
 
+        buildHotspots();
+        buildHighlights();
+
         // wrap mode
         QTextOption opt;
         opt.setWrapMode(elide ? QTextOption::NoWrap : QTextOption::WrapAtWordBoundaryOrAnywhere);
@@ -362,14 +409,75 @@ QString Text::extractSanitizedText(int from, int to) const
 
 QString Text::extractImgTooltip(int pos) const
 {
-    for (QTextBlock::Iterator itr = doc->firstBlock().begin(); itr!=doc->firstBlock().end(); ++itr)
+    const Hotspot* hotspot = hotspotAt(pos);
+    return hotspot ? hotspot->tooltip : QString();
+}
+
+/**
+@brief Indexes the fragments of the document carrying an anchor or an image tooltip.
+*/
+void Text::buildHotspots()
+{
+    hotspots.clear();
+
+    for (QTextBlock block = doc->begin(); block != doc->end(); block = block.next())
     {
-        if (itr.fragment().contains(pos) && itr.fragment().charFormat().isImageFormat())
+        for (QTextBlock::Iterator itr = block.begin(); itr != block.end(); ++itr)
         {
-            QTextImageFormat imgFmt = itr.fragment().charFormat().toImageFormat();
-            return imgFmt.toolTip();
+            QTextFragment fragment = itr.fragment();
+            QTextCharFormat format = fragment.charFormat();
+
+            QString tooltip;
+            if (format.isImageFormat())
+                tooltip = format.toImageFormat().toolTip();
+
+            if (format.anchorHref().isEmpty() && tooltip.isEmpty())
+                continue;
+
+            hotspots.append({fragment.position(), fragment.position() + fragment.length(),
+                             format.anchorHref(), tooltip});
         }
     }
 
-    return QString();
+    hotspots.squeeze();
+}
+
+/**
+@brief Finds the occurrences of the highlighted phrase in the document.
+*/
+void Text::buildHighlights()
+{
+    highlights.clear();
+
+    if (highlightPhrase.isEmpty())
+        return;
+
+    QTextCursor cursor = doc->find(highlightPhrase);
+    while (!cursor.isNull())
+    {
+        highlights.append({cursor.selectionStart(), cursor.selectionEnd()});
+        cursor = doc->find(highlightPhrase, cursor);
+    }
+}
+
+/**
+@brief Finds the hotspot covering a document position.
+@param pos Document position, as returned by cursorFromPos.
+@return The hotspot, or nullptr if there's none at this position.
+*/
+const Text::Hotspot* Text::hotspotAt(int pos) const
+{
+    if (pos < 0)
+        return nullptr;
+
+    auto itr = std::upper_bound(hotspots.cbegin(), hotspots.cend(), pos, [](int pos, const Hotspot& hotspot)
+    {
+        return pos < hotspot.start;
+    });
+
+    if (itr == hotspots.cbegin())
+        return nullptr;
+
+    --itr;
+    return pos < itr->end ? &*itr : nullptr;
 }
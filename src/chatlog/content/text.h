@@ -23,6 +23,7 @@
 #include "../chatlinecontent.h"
 
 #include <QFont>
+#include <QVector>
 
 class QTextDocument;
 
@@ -48,6 +49,7 @@ public:
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) final;
 
     virtual void visibilityChanged(bool keepInMemory) final;
+    virtual void setSearchHighlight(const QString& phrase, bool current) final;
 
     virtual qreal getAscent() const final;
     virtual void mousePressEvent(QGraphicsSceneMouseEvent *event) final override;
@@ -69,6 +71,19 @@ protected:
     QString extractSanitizedText(int from, int to) const;
     QString extractImgTooltip(int pos) const;
 
+private:
+    struct Hotspot
+    {
+        int start;
+        int end;
+        QString anchor;
+        QString tooltip;
+    };
+
+    void buildHotspots();
+    void buildHighlights();
+    const Hotspot* hotspotAt(int pos) const;
+
 private:
     QTextDocument* doc = nullptr;
     QString text;
@@ -86,6 +101,10 @@ private:
     QFont defFont;
     QString defStyleSheet;
     QColor color;
+    QVector<Hotspot> hotspots;
+    QString highlightPhrase;
+    bool highlightCurrent = false;
+    QVector<QPair<int, int>> highlights;
 
 };
 
@@ -19,8 +19,46 @@
 
 #include "timestamp.h"
 
+#include <QCache>
+
+// Number of formatted times kept for reuse
+static const int timeCacheSize = 512;
+
+/**
+@brief Formats a time, sharing the resulting string between timestamps that read the same.
+
+Messages tend to come in bursts, so consecutive timestamps usually print alike.
+The cache is keyed on the time truncated to the finest unit the format shows.
+*/
+static QString formatTime(const QDateTime& time, const QString& format)
+{
+    static QString lastFormat;
+    static qint64 resolution = 1;
+    static QCache<qint64, QString> cache(timeCacheSize);
+
+    if (format != lastFormat)
+    {
+        cache.clear();
+        lastFormat = format;
+        if (format.contains(QLatin1Char('z')))
+            resolution = 1;
+        else if (format.contains(QLatin1Char('s')))
+            resolution = 1000;
+        else
+            resolution = 60 * 1000;
+    }
+
+    const qint64 key = time.toMSecsSinceEpoch() / resolution;
+    if (QString* cached = cache.object(key))
+        return *cached;
+
+    const QString formatted = time.toString(format);
+    cache.insert(key, new QString(formatted));
+    return formatted;
+}
+
 Timestamp::Timestamp(const QDateTime &time, const QString &format, const QFont &font)
-    : Text(time.toString(format), font, false, time.toString(format))
+    : StaticText(formatTime(time, format), font, false, formatTime(time, format))
 {
     this->time = time;
 }
@@ -21,9 +21,9 @@
 #define TIMESTAMP_H
 
 #include <QDateTime>
-#include "text.h"
+#include "statictext.h"
 
-class Timestamp : public Text
+class Timestamp : public StaticText
 {
 public:
     Timestamp(const QDateTime& time, const QString& format, const QFont& font);
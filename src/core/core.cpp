@@ -20,6 +20,7 @@
 
 #include "core.h"
 #include "src/nexus.h"
+#include "src/allocstats.h"
 #include "src/core/cdata.h"
 #include "src/core/cstring.h"
 #include "src/core/coreav.h"
@@ -38,6 +39,7 @@
 #include <cassert>
 #include <limits>
 #include <functional>
+#include <algorithm>
 
 #include <QDebug>
 #include <QDir>
@@ -51,6 +53,8 @@
 #include <QList>
 #include <QBuffer>
 #include <QMutexLocker>
+#include <QReadLocker>
+#include <QWriteLocker>
 
 const QString Core::CONFIG_FILE_NAME = "data";
 const QString Core::TOX_EXT = ".tox";
@@ -58,14 +62,50 @@ QThread* Core::coreThread{nullptr};
 
 #define MAX_GROUP_MESSAGE_LEN 1024
 
+/**
+@brief Chunks of long messages sent to a friend per chunkTimer tick, by connection type.
+
+A friend relayed over TCP gets a slower pace than a direct UDP one,
+so a large paste doesn't flood the relay.
+*/
+static const int udpChunksPerTick = 4;
+static const int tcpChunksPerTick = 1;
+
+/**
+@var QQueue<std::function<void()>> Core::commands
+@brief Toxcore calls requested from other threads, run in order on the core thread.
+
+@var QReadWriteLock Core::snapshotLock
+@brief Guards the snapshot members, read by other threads instead of entering toxcore.
+
+The snapshot is written by the core thread only, whenever the data it mirrors changes.
+
+@var QHash<uint32_t, QQueue<OutgoingMessage>> Core::outgoingMessages
+@brief Messages waiting for their chunks to be sent, per friend, in order.
+*/
+
 Core::Core(QThread *CoreThread, Profile& profile) :
-    tox(nullptr), av(nullptr), profile(profile), ready{false}
+    tox(nullptr), av(nullptr), profile(profile), ready{false}, snapshotStatus{Status::Offline}
 {
     coreThread = CoreThread;
 
     toxTimer = new QTimer(this);
     toxTimer->setSingleShot(true);
     connect(toxTimer, &QTimer::timeout, this, &Core::process);
+
+    saveTimer = new QTimer(this);
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(500);
+    connect(saveTimer, &QTimer::timeout, this, [this]()
+    {
+        if (isReady())
+            profile.saveToxSaveLater(getToxSaveData());
+    });
+
+    chunkTimer = new QTimer(this);
+    chunkTimer->setSingleShot(true);
+    chunkTimer->setInterval(50);
+    connect(chunkTimer, &QTimer::timeout, this, &Core::sendPendingChunks);
     connect(&Settings::getInstance(), &Settings::dhtServerListChanged, this, &Core::process);
 
 }
@@ -101,6 +141,11 @@ Core::~Core()
         coreThread->wait(500);
     }
 
+    {
+        QMutexLocker locker{&commandMutex};
+        commands.clear();
+    }
+
     deadifyTox();
 }
 
@@ -256,14 +301,24 @@ void Core::start()
 
     // set GUI with user and statusmsg
     QString name = getUsername();
+    QString msg = getStatusMessage();
+    ToxId selfId = getSelfId();
+    Status status = getStatus();
+    {
+        QWriteLocker locker{&snapshotLock};
+        snapshotUsername = name;
+        snapshotStatusMessage = msg;
+        snapshotSelfId = selfId;
+        snapshotStatus = status;
+    }
+
     if (!name.isEmpty())
         emit usernameSet(name);
 
-    QString msg = getStatusMessage();
     if (!msg.isEmpty())
         emit statusMessageSet(msg);
 
-    QString id = getSelfId().toString();
+    QString id = selfId.toString();
     if (!id.isEmpty())
         emit idSet(id);
 
@@ -340,6 +395,8 @@ void Core::start()
 */
 void Core::process()
 {
+    ALLOC_SCOPE(Core);
+
     if (!isReady())
     {
         av->stop();
@@ -368,6 +425,72 @@ void Core::process()
     toxTimer->start(sleeptime);
 }
 
+/**
+@brief Runs a toxcore call on the core thread, without waiting for it.
+@param command Call to run, in order with the other queued calls.
+
+Other threads must not call into toxcore directly, they would compete with
+tox_iterate for its locks and block until it's done.
+*/
+void Core::queueCommand(std::function<void()> command)
+{
+    QMutexLocker locker{&commandMutex};
+    commands.enqueue(command);
+
+    // the first command wakes the core thread up, the next ones are run in the same batch
+    if (commands.size() == 1)
+        QMetaObject::invokeMethod(this, "processCommands", Qt::QueuedConnection);
+}
+
+/**
+@brief Runs the queued commands, called on the core thread.
+
+Commands left over from a toxcore instance that went away are dropped,
+they would use its friend and group numbers.
+*/
+void Core::processCommands()
+{
+    QQueue<std::function<void()>> batch;
+    {
+        QMutexLocker locker{&commandMutex};
+        batch.swap(commands);
+    }
+
+    if (!tox)
+        return;
+
+    while (!batch.isEmpty())
+        batch.dequeue()();
+}
+
+/**
+@brief Saves the .tox file shortly, together with the other changes made meanwhile.
+
+Writing the save is expensive on encrypted profiles, a burst of changes such as
+auto-away toggling or removing several friends only causes one write.
+*/
+void Core::scheduleToxSave()
+{
+    if (!saveTimer->isActive())
+        saveTimer->start();
+}
+
+/**
+@brief Empties the snapshot, when toxcore goes away.
+*/
+void Core::clearSnapshot()
+{
+    QWriteLocker locker{&snapshotLock};
+    snapshotUsername.clear();
+    snapshotStatusMessage.clear();
+    snapshotSelfId = ToxId();
+    snapshotStatus = Status::Offline;
+    snapshotFriendNames.clear();
+    snapshotFriendKeys.clear();
+    snapshotGroupPeerNames.clear();
+    snapshotGroupPeerIds.clear();
+}
+
 bool Core::checkConnection()
 {
     static bool isConnected = false;
@@ -447,9 +570,16 @@ void Core::onFriendMessage(Tox*/* tox*/, uint32_t friendId, TOX_MESSAGE_TYPE typ
 }
 
 void Core::onFriendNameChange(Tox*/* tox*/, uint32_t friendId,
-                              const uint8_t* cName, size_t cNameSize, void* core)
+                              const uint8_t* cName, size_t cNameSize, void* _core)
 {
-    emit static_cast<Core*>(core)->friendUsernameChanged(friendId, CString::toString(cName, cNameSize));
+    Core* core = static_cast<Core*>(_core);
+    QString name = CString::toString(cName, cNameSize);
+    {
+        QWriteLocker locker{&core->snapshotLock};
+        core->snapshotFriendNames[friendId] = name;
+    }
+
+    emit core->friendUsernameChanged(friendId, name);
 }
 
 void Core::onFriendTypingChange(Tox*/* tox*/, uint32_t friendId, bool isTyping, void *core)
@@ -525,10 +655,22 @@ void Core::onGroupMessage(Tox*, int groupnumber, int peernumber, const uint8_t *
     emit core->groupMessageReceived(groupnumber, peernumber, CString::toString(message, length), false);
 }
 
-void Core::onGroupNamelistChange(Tox*, int groupnumber, int peernumber, uint8_t change, void *core)
+void Core::onGroupNamelistChange(Tox*, int groupnumber, int peernumber, uint8_t change, void *_core)
 {
     qDebug() << QString("Group namelist change %1:%2 %3").arg(groupnumber).arg(peernumber).arg(change);
-    emit static_cast<Core*>(core)->groupNamelistChanged(groupnumber, peernumber, change);
+    Core* core = static_cast<Core*>(_core);
+    QList<QString> names = core->getGroupPeerNames(groupnumber);
+    QList<ToxId> ids;
+    for (int i = 0; i < names.size(); ++i)
+        ids.append(core->getGroupPeerToxId(groupnumber, i));
+
+    {
+        QWriteLocker locker{&core->snapshotLock};
+        core->snapshotGroupPeerNames[groupnumber] = names;
+        core->snapshotGroupPeerIds[groupnumber] = ids;
+    }
+
+    emit core->groupNamelistChanged(groupnumber, peernumber, change);
 }
 
 void Core::onGroupTitleChange(Tox*, int groupnumber, int peernumber, const uint8_t* title, uint8_t len, void* _core)
@@ -555,7 +697,12 @@ void Core::acceptFriendRequest(const QString& userId)
     }
     else
     {
-        profile.saveToxSave();
+        {
+            QWriteLocker locker{&snapshotLock};
+            snapshotFriendKeys[friendId] = userId;
+        }
+
+        scheduleToxSave();
         emit friendAdded(friendId, userId);
         emit friendshipChanged(friendId);
     }
@@ -600,11 +747,102 @@ void Core::requestFriendship(const QString& friendAddress, const QString& messag
             Profile* profile = Nexus::getProfile();
             if (profile->isHistoryEnabled())
                 profile->getHistory()->addNewMessage(userId, inviteStr, getSelfId().publicKey, QDateTime::currentDateTime(), true, QString());
+
+            {
+                QWriteLocker locker{&snapshotLock};
+                snapshotFriendKeys[friendId] = userId;
+            }
+
             emit friendAdded(friendId, userId);
             emit friendshipChanged(friendId);
         }
     }
-    profile.saveToxSave();
+    scheduleToxSave();
+}
+
+/**
+@brief Sends a message, from any thread, without waiting for toxcore.
+@param friendId Friend to send the message to.
+@param message Message to send, split in chunks of TOX_MAX_MESSAGE_LENGTH bytes if needed.
+@param isAction True to send it as an action (/me).
+@param receiptCallback Called on the core thread with the receipt of the message's last chunk.
+
+A message that doesn't fit in one chunk is sent a few chunks at a time by sendPendingChunks.
+*/
+void Core::queueMessage(uint32_t friendId, const QString& message, bool isAction,
+                        std::function<void(int)> receiptCallback)
+{
+    queueCommand([=]()
+    {
+        outgoingMessages[friendId].enqueue({message.toUtf8(), 0, isAction, receiptCallback});
+        if (!chunkTimer->isActive())
+            sendPendingChunks();
+    });
+}
+
+/**
+@brief Sends the next chunks of the queued messages, paced by each friend's connection.
+
+Chunks to a friend arrive in order, so the receipt of a message's last chunk
+means the whole message was delivered, that's the one given to the receipt callback.
+If toxcore's send queue is full, the chunk is retried on the next tick.
+*/
+void Core::sendPendingChunks()
+{
+    if (!tox)
+        return;
+
+    for (auto it = outgoingMessages.begin(); it != outgoingMessages.end();)
+    {
+        uint32_t friendId = it.key();
+        QQueue<OutgoingMessage>& queue = it.value();
+
+        TOX_CONNECTION connection = tox_friend_get_connection_status(tox, friendId, nullptr);
+        int budget = connection == TOX_CONNECTION_UDP ? udpChunksPerTick : tcpChunksPerTick;
+
+        while (budget > 0 && !queue.isEmpty())
+        {
+            OutgoingMessage& msg = queue.head();
+            int from = msg.sentBytes;
+            int end = msg.message.size();
+            if (end - from > TOX_MAX_MESSAGE_LENGTH)
+                end = chunkEnd(msg.message, from, TOX_MAX_MESSAGE_LENGTH);
+
+            TOX_MESSAGE_TYPE type = msg.isAction ? TOX_MESSAGE_TYPE_ACTION : TOX_MESSAGE_TYPE_NORMAL;
+            const uint8_t* chunk = reinterpret_cast<const uint8_t*>(msg.message.constData()) + from;
+            TOX_ERR_FRIEND_SEND_MESSAGE error;
+            int receipt;
+            {
+                QMutexLocker ml(&messageSendMutex);
+                receipt = tox_friend_send_message(tox, friendId, type, chunk, end - from, &error);
+            }
+
+            if (error == TOX_ERR_FRIEND_SEND_MESSAGE_SENDQ)
+                break;
+
+            --budget;
+            if (error == TOX_ERR_FRIEND_SEND_MESSAGE_OK && end < msg.message.size())
+            {
+                msg.sentBytes = end;
+                continue;
+            }
+
+            // Last chunk sent, or the message failed and the rest of it is pointless
+            emit messageSentResult(friendId, QString::fromUtf8(msg.message), receipt);
+            if (msg.receiptCallback)
+                msg.receiptCallback(receipt);
+
+            queue.dequeue();
+        }
+
+        if (queue.isEmpty())
+            it = outgoingMessages.erase(it);
+        else
+            ++it;
+    }
+
+    if (!outgoingMessages.isEmpty())
+        chunkTimer->start();
 }
 
 int Core::sendMessage(uint32_t friendId, const QString& message)
@@ -629,6 +867,9 @@ int Core::sendAction(uint32_t friendId, const QString &action)
 
 void Core::sendTyping(uint32_t friendId, bool typing)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { sendTyping(friendId, typing); });
+
     bool ret = tox_self_set_typing(tox, friendId, typing, nullptr);
     if (!ret)
         emit failedToSetTyping(typing);
@@ -636,6 +877,9 @@ void Core::sendTyping(uint32_t friendId, bool typing)
 
 void Core::sendGroupMessage(int groupId, const QString& message)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { sendGroupMessage(groupId, message); });
+
     QList<CString> cMessages = splitMessage(message, MAX_GROUP_MESSAGE_LEN);
 
     for (auto &cMsg :cMessages)
@@ -649,6 +893,9 @@ void Core::sendGroupMessage(int groupId, const QString& message)
 
 void Core::sendGroupAction(int groupId, const QString& message)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { sendGroupAction(groupId, message); });
+
     QList<CString> cMessages = splitMessage(message, MAX_GROUP_MESSAGE_LEN);
 
     for (auto &cMsg :cMessages)
@@ -662,6 +909,9 @@ void Core::sendGroupAction(int groupId, const QString& message)
 
 void Core::changeGroupTitle(int groupId, const QString& title)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { changeGroupTitle(groupId, title); });
+
     CString cTitle(title);
     int err = tox_group_set_title(tox, groupId, cTitle.data(), cTitle.size());
     if (!err)
@@ -680,36 +930,57 @@ void Core::sendAvatarFile(uint32_t friendId, const QByteArray& data)
 
 void Core::pauseResumeFileSend(uint32_t friendId, uint32_t fileNum)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { pauseResumeFileSend(friendId, fileNum); });
+
     CoreFile::pauseResumeFileSend(this, friendId, fileNum);
 }
 
 void Core::pauseResumeFileRecv(uint32_t friendId, uint32_t fileNum)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { pauseResumeFileRecv(friendId, fileNum); });
+
     CoreFile::pauseResumeFileRecv(this, friendId, fileNum);
 }
 
 void Core::cancelFileSend(uint32_t friendId, uint32_t fileNum)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { cancelFileSend(friendId, fileNum); });
+
     CoreFile::cancelFileSend(this, friendId, fileNum);
 }
 
 void Core::cancelFileRecv(uint32_t friendId, uint32_t fileNum)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { cancelFileRecv(friendId, fileNum); });
+
     CoreFile::cancelFileRecv(this, friendId, fileNum);
 }
 
 void Core::rejectFileRecvRequest(uint32_t friendId, uint32_t fileNum)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { rejectFileRecvRequest(friendId, fileNum); });
+
     CoreFile::rejectFileRecvRequest(this, friendId, fileNum);
 }
 
 void Core::acceptFileRecvRequest(uint32_t friendId, uint32_t fileNum, QString path)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { acceptFileRecvRequest(friendId, fileNum, path); });
+
     CoreFile::acceptFileRecvRequest(this, friendId, fileNum, path);
 }
 
 void Core::removeFriend(uint32_t friendId, bool fake)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { removeFriend(friendId, fake); });
+
     if (!isReady() || fake)
         return;
 
@@ -719,17 +990,31 @@ void Core::removeFriend(uint32_t friendId, bool fake)
         return;
     }
 
-    profile.saveToxSave();
+    {
+        QWriteLocker locker{&snapshotLock};
+        snapshotFriendNames.remove(friendId);
+        snapshotFriendKeys.remove(friendId);
+    }
+
+    outgoingMessages.remove(friendId);
+    scheduleToxSave();
     emit friendRemoved(friendId);
 }
 
 void Core::removeGroup(int groupId, bool fake)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { removeGroup(groupId, fake); });
+
     if (!isReady() || fake)
         return;
 
     tox_del_groupchat(tox, groupId);
     av->leaveGroupCall(groupId);
+
+    QWriteLocker locker{&snapshotLock};
+    snapshotGroupPeerNames.remove(groupId);
+    snapshotGroupPeerIds.remove(groupId);
 }
 
 /**
@@ -737,6 +1022,12 @@ void Core::removeGroup(int groupId, bool fake)
 */
 QString Core::getUsername() const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        return snapshotUsername;
+    }
+
     QString sname;
     if (!tox)
         return sname;
@@ -750,6 +1041,9 @@ QString Core::getUsername() const
 
 void Core::setUsername(const QString& username)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { setUsername(username); });
+
     if (username == getUsername())
         return;
 
@@ -761,13 +1055,21 @@ void Core::setUsername(const QString& username)
         return;
     }
 
+    {
+        QWriteLocker locker{&snapshotLock};
+        snapshotUsername = username;
+    }
+
     emit usernameSet(username);
     if (ready)
-        profile.saveToxSave();
+        scheduleToxSave();
 }
 
 void Core::setAvatar(const QByteArray& data)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { setAvatar(data); });
+
     if (!data.isEmpty())
     {
         QPixmap pic;
@@ -789,6 +1091,12 @@ void Core::setAvatar(const QByteArray& data)
 */
 ToxId Core::getSelfId() const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        return snapshotSelfId;
+    }
+
     uint8_t friendAddress[TOX_ADDRESS_SIZE] = {0};
     tox_self_get_address(tox, friendAddress);
     return ToxId(CFriendAddress::toString(friendAddress));
@@ -816,6 +1124,12 @@ QPair<QByteArray, QByteArray> Core::getKeypair() const
 */
 QString Core::getStatusMessage() const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        return snapshotStatusMessage;
+    }
+
     QString sname;
     if (!tox)
         return sname;
@@ -832,11 +1146,23 @@ QString Core::getStatusMessage() const
 */
 Status Core::getStatus() const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        return snapshotStatus;
+    }
+
+    if (!tox)
+        return Status::Offline;
+
     return (Status)tox_self_get_status(tox);
 }
 
 void Core::setStatusMessage(const QString& message)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { setStatusMessage(message); });
+
     if (message == getStatusMessage())
         return;
 
@@ -848,13 +1174,21 @@ void Core::setStatusMessage(const QString& message)
         return;
     }
 
+    {
+        QWriteLocker locker{&snapshotLock};
+        snapshotStatusMessage = message;
+    }
+
     if (ready)
-        profile.saveToxSave();
+        scheduleToxSave();
     emit statusMessageSet(message);
 }
 
 void Core::setStatus(Status status)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { setStatus(status); });
+
     TOX_USER_STATUS userstatus;
     switch (status)
     {
@@ -873,7 +1207,12 @@ void Core::setStatus(Status status)
     }
 
     tox_self_set_status(tox, userstatus);
-    profile.saveToxSave();
+    {
+        QWriteLocker locker{&snapshotLock};
+        snapshotStatus = status;
+    }
+
+    scheduleToxSave();
     emit statusSet(status);
 }
 
@@ -919,14 +1258,28 @@ void Core::loadFriends()
         {
             if (tox_friend_get_public_key(tox, ids[i], clientId, nullptr))
             {
-                emit friendAdded(ids[i], CUserId::toString(clientId));
+                QString userId = CUserId::toString(clientId);
+                {
+                    QWriteLocker locker{&snapshotLock};
+                    snapshotFriendKeys[ids[i]] = userId;
+                }
+
+                emit friendAdded(ids[i], userId);
 
                 const size_t nameSize = tox_friend_get_name_size(tox, ids[i], nullptr);
                 if (nameSize && nameSize != SIZE_MAX)
                 {
                     uint8_t *name = new uint8_t[nameSize];
                     if (tox_friend_get_name(tox, ids[i], name, nullptr))
-                        emit friendUsernameChanged(ids[i], CString::toString(name, nameSize));
+                    {
+                        QString username = CString::toString(name, nameSize);
+                        {
+                            QWriteLocker locker{&snapshotLock};
+                            snapshotFriendNames[ids[i]] = username;
+                        }
+
+                        emit friendUsernameChanged(ids[i], username);
+                    }
                     delete[] name;
                 }
 
@@ -960,6 +1313,14 @@ void Core::checkLastOnline(uint32_t friendId) {
 */
 QVector<uint32_t> Core::getFriendList() const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        QVector<uint32_t> friends = snapshotFriendKeys.keys().toVector();
+        std::sort(friends.begin(), friends.end());
+        return friends;
+    }
+
     QVector<uint32_t> friends;
     friends.resize(tox_self_get_friend_list_size(tox));
     tox_self_get_friend_list(tox, friends.data());
@@ -971,6 +1332,13 @@ QVector<uint32_t> Core::getFriendList() const
 */
 int Core::getGroupNumberPeers(int groupId) const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        auto it = snapshotGroupPeerNames.constFind(groupId);
+        return it != snapshotGroupPeerNames.constEnd() ? it->size() : -1;
+    }
+
     return tox_group_number_peers(tox, groupId);
 }
 
@@ -979,6 +1347,12 @@ int Core::getGroupNumberPeers(int groupId) const
 */
 QString Core::getGroupPeerName(int groupId, int peerId) const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        return snapshotGroupPeerNames.value(groupId).value(peerId);
+    }
+
     QString name;
     uint8_t nameArray[TOX_MAX_NAME_LENGTH];
     int length = tox_group_peername(tox, groupId, peerId, nameArray);
@@ -996,6 +1370,12 @@ QString Core::getGroupPeerName(int groupId, int peerId) const
 */
 ToxId Core::getGroupPeerToxId(int groupId, int peerId) const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        return snapshotGroupPeerIds.value(groupId).value(peerId);
+    }
+
     ToxId peerToxId;
 
     uint8_t rawID[TOX_PUBLIC_KEY_SIZE];
@@ -1015,6 +1395,12 @@ ToxId Core::getGroupPeerToxId(int groupId, int peerId) const
 */
 QList<QString> Core::getGroupPeerNames(int groupId) const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        return snapshotGroupPeerNames.value(groupId);
+    }
+
     QList<QString> names;
     if (!tox)
     {
@@ -1078,6 +1464,9 @@ void Core::quitGroupChat(int groupId) const
 
 void Core::groupInviteFriend(uint32_t friendId, int groupId)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { groupInviteFriend(friendId, groupId); });
+
     tox_invite_friend(tox, friendId, groupId);
 }
 
@@ -1178,6 +1567,12 @@ QString Core::getFriendAddress(uint32_t friendNumber) const
 */
 QString Core::getFriendPublicKey(uint32_t friendNumber) const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        return snapshotFriendKeys.value(friendNumber);
+    }
+
     uint8_t rawid[TOX_PUBLIC_KEY_SIZE];
     if (!tox_friend_get_public_key(tox, friendNumber, rawid, nullptr))
     {
@@ -1195,6 +1590,12 @@ QString Core::getFriendPublicKey(uint32_t friendNumber) const
 */
 QString Core::getFriendUsername(uint32_t friendnumber) const
 {
+    if (QThread::currentThread() != coreThread)
+    {
+        QReadLocker locker{&snapshotLock};
+        return snapshotFriendNames.value(friendnumber);
+    }
+
     size_t namesize = tox_friend_get_name_size(tox, friendnumber, nullptr);
     if (namesize == SIZE_MAX)
     {
@@ -1213,30 +1614,49 @@ QList<CString> Core::splitMessage(const QString &message, int maxLen)
     QList<CString> splittedMsgs;
     QByteArray ba_message(message.toUtf8());
 
-    while (ba_message.size() > maxLen)
+    int pos = 0;
+    while (ba_message.size() - pos > maxLen)
     {
-        int splitPos = ba_message.lastIndexOf(' ', maxLen - 1);
-        if (splitPos <= 0)
-        {
-            splitPos = maxLen;
-            if (ba_message[splitPos] & 0x80)
-            {
-                do {
-                    splitPos--;
-                } while (!(ba_message[splitPos] & 0x40));
-            }
-            splitPos--;
-        }
-
-        splittedMsgs.push_back(CString(ba_message.left(splitPos + 1)));
-        ba_message = ba_message.mid(splitPos + 1);
+        int end = chunkEnd(ba_message, pos, maxLen);
+        splittedMsgs.push_back(CString(QByteArray::fromRawData(ba_message.constData() + pos, end - pos)));
+        pos = end;
     }
 
-    splittedMsgs.push_back(CString(ba_message));
+    splittedMsgs.push_back(CString(QByteArray::fromRawData(ba_message.constData() + pos,
+                                                           ba_message.size() - pos)));
 
     return splittedMsgs;
 }
 
+/**
+@brief Finds where the chunk of a message starting at from should end.
+@param message UTF-8 message, with more than maxLen bytes left after from.
+@param from Start of the chunk.
+@param maxLen Maximum length of the chunk.
+@return Index one past the chunk's last byte.
+
+Prefers ending the chunk after a space, otherwise never splits a UTF-8 character.
+Only looks at the chunk itself, so splitting a whole message is linear.
+*/
+int Core::chunkEnd(const QByteArray& message, int from, int maxLen)
+{
+    const char* data = message.constData();
+    int limit = from + maxLen;
+
+    for (int i = limit - 1; i > from; --i)
+    {
+        if (data[i] == ' ')
+            return i + 1;
+    }
+
+    // Back up from a continuation byte to the start of its character
+    int end = limit;
+    while ((data[end] & 0xC0) == 0x80)
+        --end;
+
+    return end;
+}
+
 QString Core::getPeerName(const ToxId& id) const
 {
     QString name;
@@ -1276,11 +1696,20 @@ bool Core::isReady()
 
 void Core::setNospam(uint32_t nospam)
 {
+    if (QThread::currentThread() != coreThread)
+        return queueCommand([=]() { setNospam(nospam); });
+
     uint8_t *nspm = reinterpret_cast<uint8_t*>(&nospam);
     std::reverse(nspm, nspm + 4);
     tox_self_set_nospam(tox, nospam);
 
-    emit idSet(getSelfId().toString());
+    ToxId selfId = getSelfId();
+    {
+        QWriteLocker locker{&snapshotLock};
+        snapshotSelfId = selfId;
+    }
+
+    emit idSet(selfId.toString());
 }
 
 /**
@@ -1291,6 +1720,8 @@ void Core::killTimers(bool onlyStop)
     assert(QThread::currentThread() == coreThread);
     av->stop();
     toxTimer->stop();
+    saveTimer->stop();
+    chunkTimer->stop();
     if (!onlyStop)
     {
         delete toxTimer;
@@ -1309,6 +1740,12 @@ void Core::reset()
     ready = false;
     killTimers(true);
     deadifyTox();
+    clearSnapshot();
+    outgoingMessages.clear();
+    {
+        QMutexLocker locker{&commandMutex};
+        commands.clear();
+    }
 
     emit selfAvatarChanged(QPixmap(":/img/contact_dark.svg"));
     GUI::clearContacts();
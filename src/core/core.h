@@ -24,6 +24,10 @@
 #include <cstdint>
 #include <QObject>
 #include <QMutex>
+#include <QQueue>
+#include <QReadWriteLock>
+#include <QHash>
+#include <functional>
 
 #include <tox/tox.h>
 #include <tox/toxencryptsave.h>
@@ -88,6 +92,9 @@ public:
 
     bool isReady();
 
+    void queueMessage(uint32_t friendId, const QString& message, bool isAction,
+                      std::function<void(int)> receiptCallback = {});
+
 public slots:
     void start();
     void reset();
@@ -225,17 +232,50 @@ private:
 
     void deadifyTox();
 
+    void queueCommand(std::function<void()> command);
+    void scheduleToxSave();
+    void clearSnapshot();
+
+    static int chunkEnd(const QByteArray& message, int from, int maxLen);
+
 private slots:
     void killTimers(bool onlyStop);
+    void processCommands();
+    void sendPendingChunks();
 
 private:
+    struct OutgoingMessage
+    {
+        QByteArray message;
+        int sentBytes;
+        bool isAction;
+        std::function<void(int)> receiptCallback;
+    };
+
     Tox* tox;
     CoreAV* av;
     QTimer *toxTimer;
+    QTimer *saveTimer;
+    QTimer *chunkTimer;
     Profile& profile;
     QMutex messageSendMutex;
     bool ready;
 
+    QMutex commandMutex;
+    QQueue<std::function<void()>> commands;
+
+    QHash<uint32_t, QQueue<OutgoingMessage>> outgoingMessages;
+
+    mutable QReadWriteLock snapshotLock;
+    QString snapshotUsername;
+    QString snapshotStatusMessage;
+    ToxId snapshotSelfId;
+    Status snapshotStatus;
+    QHash<uint32_t, QString> snapshotFriendNames;
+    QHash<uint32_t, QString> snapshotFriendKeys;
+    QHash<int, QList<QString>> snapshotGroupPeerNames;
+    QHash<int, QList<ToxId>> snapshotGroupPeerIds;
+
     static QThread *coreThread;
 
     friend class Audio; ///< Audio can access our calls directly to reduce latency
@@ -29,7 +29,6 @@
 #include <QTimer>
 #include <QDebug>
 #include <QCoreApplication>
-#include <QtConcurrent/QtConcurrentRun>
 
 /**
 @fn void CoreAV::avInvite(uint32_t friendId, bool video)
@@ -48,25 +47,20 @@
 */
 
 /**
-@var CoreAV::AUDIO_DEFAULT_BITRATE
-@brief In kb/s. More than enough for Opus.
-
 @var CoreAV::VIDEO_DEFAULT_BITRATE
 @brief Picked at random by fair dice roll.
 */
 
 /**
-@var std::atomic_flag CoreAV::threadSwitchLock
-@brief This flag is to be acquired before switching in a blocking way between the UI and CoreAV thread.
-
-The CoreAV thread must have priority for the flag, other threads should back off or release it quickly.
-CoreAV needs to interface with three threads, the toxcore/Core thread that fires non-payload
+@class CoreAV
+@note CoreAV talks to three threads: the toxcore/Core thread that fires non-payload
 toxav callbacks, the toxav/CoreAV thread that fires AV payload callbacks and manages
 most of CoreAV's members, and the UI thread, which calls our [start/answer/cancel]Call functions
-and which we call via signals.
-When the UI calls us, we switch from the UI thread to the CoreAV thread to do the processing,
-when toxcore fires a non-payload av callback, we do the processing in the CoreAV thread and then
-switch to the UI thread to send it a signal. Both switches block both threads, so this would deadlock.
+and which we notify via signals.
+
+The CoreAV thread's event queue is the only way in: toxcore callbacks post to it without
+waiting, and the UI blocks on it when it needs a result. The CoreAV thread itself never
+blocks on another thread, its signals to the UI are queued, so neither switch can deadlock.
 */
 
 /**
@@ -82,8 +76,7 @@ IndexedList<ToxGroupCall> CoreAV::groupCalls;
 using namespace std;
 
 CoreAV::CoreAV(Tox *tox)
-    : coreavThread{new QThread}, iterateTimer{new QTimer{this}},
-      threadSwitchLock{false}
+    : coreavThread{new QThread}, iterateTimer{new QTimer{this}}
 {
     coreavThread->setObjectName("qTox CoreAV");
     moveToThread(coreavThread.get());
@@ -99,6 +92,8 @@ CoreAV::CoreAV(Tox *tox)
     toxav_callback_audio_receive_frame(toxav, CoreAV::audioFrameCallback, this);
     toxav_callback_video_receive_frame(toxav, CoreAV::videoFrameCallback, this);
 
+    connect(&Audio::getInstance(), &Audio::profileChanged, this, &CoreAV::updateAudioBitrate);
+
     coreavThread->start();
 }
 
@@ -180,24 +175,22 @@ bool CoreAV::answerCall(uint32_t friendNum)
 {
     if (QThread::currentThread() != coreavThread.get())
     {
-        if (threadSwitchLock.test_and_set(std::memory_order_acquire))
-        {
-            qDebug() << "CoreAV::answerCall: Backed off of thread-switch lock";
-            return false;
-        }
-
         bool ret;
         QMetaObject::invokeMethod(this, "answerCall", Qt::BlockingQueuedConnection,
                                     Q_RETURN_ARG(bool, ret), Q_ARG(uint32_t, friendNum));
-
-        threadSwitchLock.clear(std::memory_order_release);
         return ret;
     }
 
     qDebug() << QString("answering call %1").arg(friendNum);
-    assert(calls.contains(friendNum));
+    if (!calls.contains(friendNum))
+    {
+        qWarning() << QString("Can't answer call with %1, it has already ended").arg(friendNum);
+        return false;
+    }
+
     TOXAV_ERR_ANSWER err;
-    if (toxav_answer(toxav, friendNum, AUDIO_DEFAULT_BITRATE, VIDEO_DEFAULT_BITRATE, &err))
+    uint32_t audioBitrate = Audio::getInstance().getProfile().bitrate;
+    if (toxav_answer(toxav, friendNum, audioBitrate, VIDEO_DEFAULT_BITRATE, &err))
     {
         calls[friendNum].inactive = false;
         return true;
@@ -215,17 +208,9 @@ bool CoreAV::startCall(uint32_t friendNum, bool video)
 {
     if (QThread::currentThread() != coreavThread.get())
     {
-        if (threadSwitchLock.test_and_set(std::memory_order_acquire))
-        {
-            qDebug() << "CoreAV::startCall: Backed off of thread-switch lock";
-            return false;
-        }
         bool ret;
-
-        (void)QMetaObject::invokeMethod(this, "startCall", Qt::BlockingQueuedConnection,
+        QMetaObject::invokeMethod(this, "startCall", Qt::BlockingQueuedConnection,
                                     Q_RETURN_ARG(bool, ret), Q_ARG(uint32_t, friendNum), Q_ARG(bool, video));
-
-        threadSwitchLock.clear(std::memory_order_release);
         return ret;
     }
 
@@ -237,7 +222,8 @@ bool CoreAV::startCall(uint32_t friendNum, bool video)
     }
 
     uint32_t videoBitrate = video ? VIDEO_DEFAULT_BITRATE : 0;
-    if (!toxav_call(toxav, friendNum, AUDIO_DEFAULT_BITRATE, videoBitrate, nullptr))
+    uint32_t audioBitrate = Audio::getInstance().getProfile().bitrate;
+    if (!toxav_call(toxav, friendNum, audioBitrate, videoBitrate, nullptr))
         return false;
 
     auto call = calls.insert({friendNum, video, *this});
@@ -249,17 +235,9 @@ bool CoreAV::cancelCall(uint32_t friendNum)
 {
     if (QThread::currentThread() != coreavThread.get())
     {
-        if (threadSwitchLock.test_and_set(std::memory_order_acquire))
-        {
-            qDebug() << "CoreAV::cancelCall: Backed off of thread-switch lock";
-            return false;
-        }
-
         bool ret;
         QMetaObject::invokeMethod(this, "cancelCall", Qt::BlockingQueuedConnection,
                                     Q_RETURN_ARG(bool, ret), Q_ARG(uint32_t, friendNum));
-
-        threadSwitchLock.clear(std::memory_order_release);
         return ret;
     }
 
@@ -574,24 +552,27 @@ void CoreAV::sendNoVideo()
     }
 }
 
+/**
+@brief Applies the bitrate of the current audio profile to all calls.
+*/
+void CoreAV::updateAudioBitrate()
+{
+    uint32_t audioBitrate = Audio::getInstance().getProfile().bitrate;
+    for (ToxFriendCall& call : calls)
+        toxav_bit_rate_set(toxav, call.callId, audioBitrate, -1, nullptr);
+}
+
 void CoreAV::callCallback(ToxAV* toxav, uint32_t friendNum, bool audio, bool video, void *_self)
 {
     CoreAV* self = static_cast<CoreAV*>(_self);
 
     // Run this slow callback asynchronously on the AV thread to avoid deadlocks with what our caller (toxcore) holds
-    // Also run the code to switch to the CoreAV thread in yet another thread, in case CoreAV
-    // has threadSwitchLock and wants a toxcore lock that our call stack is holding...
+    // Posting to the CoreAV thread's event queue never waits, so we can do it right from toxcore's call stack
     if (QThread::currentThread() != self->coreavThread.get())
     {
-        QtConcurrent::run([=](){
-            // We assume the original caller doesn't come from the CoreAV thread here
-            while (self->threadSwitchLock.test_and_set(std::memory_order_acquire))
-                QThread::yieldCurrentThread(); // Shouldn't spin for long, we have priority
-
-            QMetaObject::invokeMethod(self, "callCallback", Qt::QueuedConnection,
-                                                    Q_ARG(ToxAV*, toxav), Q_ARG(uint32_t, friendNum),
-                                                    Q_ARG(bool, audio), Q_ARG(bool, video), Q_ARG(void*, _self));
-        });
+        QMetaObject::invokeMethod(self, "callCallback", Qt::QueuedConnection,
+                                  Q_ARG(ToxAV*, toxav), Q_ARG(uint32_t, friendNum),
+                                  Q_ARG(bool, audio), Q_ARG(bool, video), Q_ARG(void*, _self));
         return;
     }
 
@@ -616,7 +597,6 @@ void CoreAV::callCallback(ToxAV* toxav, uint32_t friendNum, bool audio, bool vid
     callIt->state = static_cast<TOXAV_FRIEND_CALL_STATE>(state);
 
     emit reinterpret_cast<CoreAV*>(self)->avInvite(friendNum, video);
-    self->threadSwitchLock.clear(std::memory_order_release);
 }
 
 void CoreAV::stateCallback(ToxAV* toxav, uint32_t friendNum, uint32_t state, void *_self)
@@ -624,26 +604,18 @@ void CoreAV::stateCallback(ToxAV* toxav, uint32_t friendNum, uint32_t state, voi
     CoreAV* self = static_cast<CoreAV*>(_self);
 
     // Run this slow callback asynchronously on the AV thread to avoid deadlocks with what our caller (toxcore) holds
-    // Also run the code to switch to the CoreAV thread in yet another thread, in case CoreAV
-    // has threadSwitchLock and wants a toxcore lock that our call stack is holding...
+    // Posting to the CoreAV thread's event queue never waits, so we can do it right from toxcore's call stack
     if (QThread::currentThread() != self->coreavThread.get())
     {
-        QtConcurrent::run([=](){
-            // We assume the original caller doesn't come from the CoreAV thread here
-            while (self->threadSwitchLock.test_and_set(std::memory_order_acquire))
-                QThread::yieldCurrentThread(); // Shouldn't spin for long, we have priority
-
-            QMetaObject::invokeMethod(self, "stateCallback", Qt::QueuedConnection,
-                                                Q_ARG(ToxAV*, toxav), Q_ARG(uint32_t, friendNum),
-                                                Q_ARG(uint32_t, state), Q_ARG(void*, _self));
-        });
+        QMetaObject::invokeMethod(self, "stateCallback", Qt::QueuedConnection,
+                                  Q_ARG(ToxAV*, toxav), Q_ARG(uint32_t, friendNum),
+                                  Q_ARG(uint32_t, state), Q_ARG(void*, _self));
         return;
     }
 
     if (!self->calls.contains(friendNum))
     {
         qWarning() << QString("stateCallback called, but call %1 is already dead").arg(friendNum);
-        self->threadSwitchLock.clear(std::memory_order_release);
         return;
     }
 
@@ -689,7 +661,6 @@ void CoreAV::stateCallback(ToxAV* toxav, uint32_t friendNum, uint32_t state, voi
 
         call.state = static_cast<TOXAV_FRIEND_CALL_STATE>(state);
     }
-    self->threadSwitchLock.clear(std::memory_order_release);
 }
 
 void CoreAV::bitrateCallback(ToxAV* toxav, uint32_t friendNum, uint32_t arate, uint32_t vrate, void *_self)
@@ -23,7 +23,6 @@
 
 #include <QObject>
 #include <memory>
-#include <atomic>
 #include "src/core/toxcall.h"
 #include <tox/toxav.h>
 
@@ -92,6 +91,7 @@ private slots:
     static void stateCallback(ToxAV *, uint32_t friendNum, uint32_t state, void* self);
     static void bitrateCallback(ToxAV *toxAV, uint32_t friendNum, uint32_t arate, uint32_t vrate, void* self);
     void killTimerFromThread();
+    void updateAudioBitrate();
 
 private:
     void process();
@@ -102,7 +102,6 @@ private:
                                    int32_t ystride, int32_t ustride, int32_t vstride, void* self);
 
 private:
-    static constexpr uint32_t AUDIO_DEFAULT_BITRATE = 64;
     static constexpr uint32_t VIDEO_DEFAULT_BITRATE = 6144;
 
 private:
@@ -111,7 +110,6 @@ private:
     std::unique_ptr<QTimer> iterateTimer;
     static IndexedList<ToxFriendCall> calls;
     static IndexedList<ToxGroupCall> groupCalls;
-    std::atomic_flag threadSwitchLock;
 
     friend class Audio;
 };
@@ -234,6 +234,7 @@ void CoreFile::acceptFileRecvRequest(Core* core, uint32_t friendId, uint32_t fil
         return;
     }
     file->status = ToxFile::TRANSMITTING;
+    file->startTime = QDateTime::currentDateTime();
     emit core->fileTransferAccepted(*file);
     tox_file_control(core->tox, file->friendId, file->fileNum, TOX_FILE_CONTROL_RESUME, nullptr);
 }
@@ -16,12 +16,15 @@ They should include this file directly instead to reduce compilation times
 /**
 @var uint8_t ToxFile::fileKind
 @brief Data file (default) or avatar
+
+@var QDateTime ToxFile::startTime
+@brief When the transfer was offered, or accepted for incoming ones.
 */
 
 ToxFile::ToxFile(uint32_t fileNum, uint32_t friendId, QByteArray filename, QString filePath, FileDirection Direction)
     : fileKind{TOX_FILE_KIND_DATA}, fileNum(fileNum), friendId(friendId), fileName{filename},
       filePath{filePath}, file{new QFile(filePath)}, bytesSent{0}, filesize{0},
-      status{STOPPED}, direction{Direction}
+      status{STOPPED}, direction{Direction}, startTime{QDateTime::currentDateTime()}
 {
 }
 
@@ -2,6 +2,7 @@
 #define CORESTRUCTS_H
 
 #include <QString>
+#include <QDateTime>
 #include <memory>
 
 class QFile;
@@ -55,6 +56,7 @@ struct ToxFile
     FileDirection direction;
     QByteArray avatarData;
     QByteArray resumeFileId;
+    QDateTime startTime;
 };
 
 #endif // CORESTRUCTS_H
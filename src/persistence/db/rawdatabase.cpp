@@ -1,10 +1,12 @@
 #include "rawdatabase.h"
+#include "src/allocstats.h"
 #include <QDebug>
 #include <QMetaObject>
 #include <QMutexLocker>
 #include <QCoreApplication>
 #include <QFile>
 #include <cassert>
+#include <cstdlib>
 #include <tox/toxencryptsave.h>
 
 /// The two following defines are required to use SQLCipher
@@ -62,6 +64,87 @@ A transaction is made of queries, which can have bound BLOBs.
 @brief If not a nullptr, will be set to true when the transaction has been executed
 */
 
+#ifdef QTOX_ALLOC_PROFILING
+// SQLite's allocator, charging its memory to AllocStats::Persistence.
+// Blocks are prefixed with their size, which keeps the 8 byte alignment SQLite needs.
+
+static void* sqliteMalloc(int size)
+{
+    qint64* block = static_cast<qint64*>(std::malloc(sizeof(qint64) + size));
+    if (!block)
+        return nullptr;
+
+    block[0] = size;
+    AllocStats::allocated(AllocStats::Persistence, size);
+    return block + 1;
+}
+
+static void sqliteFree(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    qint64* block = static_cast<qint64*>(ptr) - 1;
+    AllocStats::freed(AllocStats::Persistence, block[0]);
+    std::free(block);
+}
+
+static void* sqliteRealloc(void* ptr, int size)
+{
+    // SQLite never reallocates a null pointer
+    qint64* block = static_cast<qint64*>(ptr) - 1;
+    qint64 oldSize = block[0];
+    block = static_cast<qint64*>(std::realloc(block, sizeof(qint64) + size));
+    if (!block)
+        return nullptr;
+
+    block[0] = size;
+    AllocStats::freed(AllocStats::Persistence, oldSize);
+    AllocStats::allocated(AllocStats::Persistence, size);
+    return block + 1;
+}
+
+static int sqliteSize(void* ptr)
+{
+    return ptr ? static_cast<int>(static_cast<qint64*>(ptr)[-1]) : 0;
+}
+
+static int sqliteRoundup(int size)
+{
+    return (size + 7) & ~7;
+}
+
+static int sqliteInit(void*)
+{
+    return SQLITE_OK;
+}
+
+static void sqliteShutdown(void*)
+{
+}
+
+/**
+@brief Routes SQLite's allocations through AllocStats.
+@return True on success, false if SQLite was already initialized.
+*/
+static bool installSqliteAllocator()
+{
+    static const sqlite3_mem_methods methods =
+    {
+        sqliteMalloc, sqliteFree, sqliteRealloc, sqliteSize,
+        sqliteRoundup, sqliteInit, sqliteShutdown, nullptr
+    };
+
+    if (sqlite3_config(SQLITE_CONFIG_MALLOC, &methods) != SQLITE_OK)
+    {
+        qWarning() << "Failed to route SQLite's allocations through the allocation accounting";
+        return false;
+    }
+
+    return true;
+}
+#endif
+
 /**
 @brief Tries to open a database.
 @param path Path to database.
@@ -109,6 +192,12 @@ bool RawDatabase::open(const QString& path, const QString &hexKey)
         QFile::rename(path+".tmp", path);
     }
 
+#ifdef QTOX_ALLOC_PROFILING
+    // SQLite only takes an allocator before it's initialized, which the first open does
+    static const bool sqliteAccounted = installSqliteAllocator();
+    Q_UNUSED(sqliteAccounted);
+#endif
+
     if (sqlite3_open_v2(path.toUtf8().data(), &sqlite,
                         SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
     {
@@ -446,6 +535,8 @@ Unqueues, compiles, binds and executes queries, then notifies of results
 */
 void RawDatabase::process()
 {
+    ALLOC_SCOPE(Persistence);
+
     assert(QThread::currentThread() == workerThread.get());
 
     if (!sqlite)
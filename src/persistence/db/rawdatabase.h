@@ -29,6 +29,8 @@ public:
             : query{query.toUtf8()}, insertCallback{insertCallback} {}
         Query(QString query, std::function<void(const QVector<QVariant>&)> rowCallback)
             : query{query.toUtf8()}, rowCallback{rowCallback} {}
+        Query(QString query, QVector<QByteArray> blobs, std::function<void(const QVector<QVariant>&)> rowCallback)
+            : query{query.toUtf8()}, blobs{blobs}, rowCallback{rowCallback} {}
         Query() = default;
     private:
         QByteArray query;
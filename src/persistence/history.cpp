@@ -3,6 +3,7 @@
 #include "src/persistence/settings.h"
 #include "src/persistence/db/rawdatabase.h"
 #include "src/persistence/historykeeper.h"
+#include "src/allocstats.h"
 #include <QDebug>
 #include <cassert>
 
@@ -92,6 +93,7 @@ void History::eraseHistory()
                "DELETE FROM history;"
                "DELETE FROM aliases;"
                "DELETE FROM peers;"
+               "DELETE FROM file_transfers;"
                "VACUUM;");
 }
 
@@ -101,6 +103,8 @@ void History::eraseHistory()
 */
 void History::removeFriendHistory(const QString &friendPk)
 {
+    db.execLater(QString("DELETE FROM file_transfers WHERE peer='%1';").arg(friendPk));
+
     if (!peers.contains(friendPk))
         return;
     int64_t id = peers[friendPk];
@@ -205,6 +209,8 @@ QVector<RawDatabase::Query> History::generateNewMessageQueries(const QString &fr
 void History::addNewMessage(const QString &friendPk, const QString &message, const QString &sender,
                 const QDateTime &time, bool isSent, QString dispName, std::function<void(int64_t)> insertIdCallback)
 {
+    ALLOC_SCOPE(Persistence);
+
     db.execLater(generateNewMessageQueries(friendPk, message, sender, time, isSent, dispName, insertIdCallback));
 }
 
@@ -217,6 +223,8 @@ void History::addNewMessage(const QString &friendPk, const QString &message, con
 */
 QList<History::HistMessage> History::getChatHistory(const QString &friendPk, const QDateTime &from, const QDateTime &to)
 {
+    ALLOC_SCOPE(Persistence);
+
     QList<HistMessage> messages;
 
     auto rowCallback = [&messages](const QVector<QVariant>& row)
@@ -244,6 +252,83 @@ QList<History::HistMessage> History::getChatHistory(const QString &friendPk, con
     return messages;
 }
 
+/**
+@brief Fetches a page of the chat history, newest messages first.
+@param friendPk Friend public key to fetch.
+@param from Messages older than this are never returned.
+@param before Only messages older than this are returned,
+or as old but with an ID lower than beforeId, to continue after the previous page.
+@param beforeId ID of the last message of the previous page, 0 for the first page.
+@param limit Maximum number of messages in the page.
+@return Messages, newest first.
+*/
+QList<History::HistMessage> History::getChatHistoryPage(const QString& friendPk, const QDateTime& from,
+                                                        const QDateTime& before, qint64 beforeId, int limit)
+{
+    ALLOC_SCOPE(Persistence);
+
+    QList<HistMessage> messages;
+
+    auto rowCallback = [&messages](const QVector<QVariant>& row)
+    {
+        // dispName and message could have null bytes, QString::fromUtf8 truncates on null bytes so we strip them
+        messages += {row[0].toLongLong(),
+                    row[1].isNull(),
+                    QDateTime::fromMSecsSinceEpoch(row[2].toLongLong()),
+                    row[3].toString(),
+                    QString::fromUtf8(row[4].toByteArray().replace('\0',"")),
+                    row[5].toString(),
+                    QString::fromUtf8(row[6].toByteArray().replace('\0',""))};
+    };
+
+    qint64 beforeMs = before.toMSecsSinceEpoch();
+
+    // Don't forget to update the rowCallback if you change the selected columns!
+    db.execNow({QString("SELECT history.id, faux_offline_pending.id, timestamp, chat.public_key, "
+                               "aliases.display_name, sender.public_key, message FROM history "
+                       "LEFT JOIN faux_offline_pending ON history.id = faux_offline_pending.id "
+                       "JOIN peers chat ON chat_id = chat.id "
+                       "JOIN aliases ON sender_alias = aliases.id "
+                       "JOIN peers sender ON aliases.owner = sender.id "
+                       "WHERE timestamp >= %1 AND (timestamp < %2 OR (timestamp = %2 AND history.id < %3)) "
+                       "AND chat.public_key='%4' "
+                       "ORDER BY timestamp DESC, history.id DESC LIMIT %5;")
+                        .arg(from.toMSecsSinceEpoch()).arg(beforeMs).arg(beforeId).arg(friendPk).arg(limit),
+                rowCallback});
+
+    return messages;
+}
+
+/**
+@brief Finds the latest message of a chat containing a phrase.
+@param friendPk Friend public key of the chat.
+@param before Only messages older than this date are searched.
+@param phrase Phrase to find, case insensitive for ASCII letters.
+@return Date of the message, or an invalid date if there is none.
+*/
+QDateTime History::getDateWhereFindPhrase(const QString& friendPk, const QDateTime& before, QString phrase)
+{
+    QDateTime date;
+    auto rowCallback = [&date](const QVector<QVariant>& row)
+    {
+        date = QDateTime::fromMSecsSinceEpoch(row[0].toLongLong());
+    };
+
+    // the phrase is matched literally
+    phrase.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+
+    RawDatabase::Query query(QString("SELECT timestamp FROM history "
+                                     "JOIN peers chat ON chat_id = chat.id "
+                                     "WHERE chat.public_key='%1' AND timestamp < %2 "
+                                     "AND message LIKE ? ESCAPE '\\' "
+                                     "ORDER BY timestamp DESC LIMIT 1;")
+                                .arg(friendPk).arg(before.toMSecsSinceEpoch()),
+                             {QString("%%1%").arg(phrase).toUtf8()}, rowCallback);
+    db.execNow(query);
+
+    return date;
+}
+
 /**
 @brief Marks a message as sent.
 Removing message from the faux-offline pending messages list.
@@ -255,6 +340,117 @@ void History::markAsSent(qint64 id)
     db.execLater(QString("DELETE FROM faux_offline_pending WHERE id=%1;").arg(id));
 }
 
+/**
+@brief Gets a cached avatar.
+@param ownerPk Public key of the avatar's owner.
+@return Avatar image data, empty if none is cached.
+*/
+QByteArray History::getAvatar(const QString& ownerPk)
+{
+    QByteArray pic;
+    auto rowCallback = [&pic](const QVector<QVariant>& row)
+    {
+        // The blob points into sqlite's memory, which is gone after the callback
+        QByteArray data = row[0].toByteArray();
+        pic = QByteArray(data.constData(), data.size());
+    };
+
+    db.execNow(RawDatabase::Query{QString("SELECT data FROM avatars WHERE owner='%1';").arg(ownerPk),
+                                  rowCallback});
+    return pic;
+}
+
+/**
+@brief Caches an avatar, replacing only the owner's previous one.
+@param ownerPk Public key of the avatar's owner.
+@param pic Avatar image data.
+*/
+void History::setAvatar(const QString& ownerPk, const QByteArray& pic)
+{
+    db.execLater(RawDatabase::Query{QString("INSERT OR REPLACE INTO avatars (owner, data) VALUES ('%1', ?);")
+                                        .arg(ownerPk), {pic}});
+}
+
+/**
+@brief Caches an avatar read from an old avatar file, unless a newer one is already cached.
+@param ownerPk Public key of the avatar's owner.
+@param pic Avatar image data.
+*/
+void History::importAvatar(const QString& ownerPk, const QByteArray& pic)
+{
+    db.execLater(RawDatabase::Query{QString("INSERT OR IGNORE INTO avatars (owner, data) VALUES ('%1', ?);")
+                                        .arg(ownerPk), {pic}});
+}
+
+/**
+@brief Removes a cached avatar.
+@param ownerPk Public key of the avatar's owner.
+*/
+void History::removeAvatar(const QString& ownerPk)
+{
+    db.execLater(QString("DELETE FROM avatars WHERE owner='%1';").arg(ownerPk));
+}
+
+/**
+@brief Records a finished or cancelled file transfer.
+@param transfer Transfer to record, its ID is ignored.
+@param insertIdCallback Function called with the ID of the new row.
+*/
+void History::addFileTransfer(const FileTransfer& transfer, std::function<void(int64_t)> insertIdCallback)
+{
+    db.execLater(RawDatabase::Query{QString("INSERT INTO file_transfers (peer, outgoing, completed, file_name, "
+                                            "file_path, file_size, start_time, end_time, file_hash) "
+                                            "VALUES ('%1', %2, %3, ?, ?, %4, %5, %6, ?);")
+                                        .arg(transfer.peer).arg(transfer.outgoing).arg(transfer.completed)
+                                        .arg(transfer.size).arg(transfer.started.toMSecsSinceEpoch())
+                                        .arg(transfer.finished.toMSecsSinceEpoch()),
+                                    {transfer.fileName.toUtf8(), transfer.filePath.toUtf8(), transfer.hash},
+                                    insertIdCallback});
+}
+
+/**
+@brief Sets the hash of a recorded file transfer, once the file is hashed.
+@param id ID of the transfer.
+@param hash SHA-256 of the file.
+*/
+void History::setFileTransferHash(int64_t id, const QByteArray& hash)
+{
+    db.execLater(RawDatabase::Query{QString("UPDATE file_transfers SET file_hash = ? WHERE id = %1;").arg(id),
+                                    {hash}});
+}
+
+/**
+@brief Fetches every recorded file transfer.
+@return Transfers, latest finished first.
+*/
+QList<History::FileTransfer> History::getFileTransfers()
+{
+    QList<FileTransfer> transfers;
+
+    auto rowCallback = [&transfers](const QVector<QVariant>& row)
+    {
+        // The blobs point into sqlite's memory, which is gone after the callback
+        QByteArray hash = row[9].toByteArray();
+        transfers += {row[0].toLongLong(),
+                      row[1].toString(),
+                      QString::fromUtf8(row[4].toByteArray()),
+                      QString::fromUtf8(row[5].toByteArray()),
+                      row[6].toLongLong(),
+                      row[2].toBool(),
+                      row[3].toBool(),
+                      QDateTime::fromMSecsSinceEpoch(row[7].toLongLong()),
+                      QDateTime::fromMSecsSinceEpoch(row[8].toLongLong()),
+                      QByteArray(hash.constData(), hash.size())};
+    };
+
+    // Don't forget to update the rowCallback if you change the selected columns!
+    db.execNow(RawDatabase::Query{"SELECT id, peer, outgoing, completed, file_name, file_path, file_size, "
+                                  "start_time, end_time, file_hash FROM file_transfers ORDER BY end_time DESC;",
+                                  rowCallback});
+
+    return transfers;
+}
+
 /**
 @brief Retrieves the path to the database file for a given profile.
 @param profileName Profile name.
@@ -282,7 +478,14 @@ void History::init()
                  "CREATE TABLE IF NOT EXISTS history (id INTEGER PRIMARY KEY, timestamp INTEGER NOT NULL, "
                                                      "chat_id INTEGER NOT NULL, sender_alias INTEGER NOT NULL, "
                                                      "message BLOB NOT NULL);"
-                 "CREATE TABLE IF NOT EXISTS faux_offline_pending (id INTEGER PRIMARY KEY);");
+                 "CREATE TABLE IF NOT EXISTS faux_offline_pending (id INTEGER PRIMARY KEY);"
+                 "CREATE TABLE IF NOT EXISTS avatars (owner TEXT PRIMARY KEY, data BLOB NOT NULL);"
+                 "CREATE TABLE IF NOT EXISTS file_transfers (id INTEGER PRIMARY KEY, peer TEXT NOT NULL, "
+                                                     "outgoing INTEGER NOT NULL, completed INTEGER NOT NULL, "
+                                                     "file_name BLOB NOT NULL, file_path BLOB NOT NULL, "
+                                                     "file_size INTEGER NOT NULL, start_time INTEGER NOT NULL, "
+                                                     "end_time INTEGER NOT NULL, file_hash BLOB);"
+                 "CREATE INDEX IF NOT EXISTS file_transfers_end_time ON file_transfers (end_time);");
 
     // Cache our current peers
     db.execLater(RawDatabase::Query{"SELECT public_key, id FROM peers;", [this](const QVector<QVariant>& row)
@@ -29,6 +29,20 @@ public:
         bool isSent;
     };
 
+    struct FileTransfer
+    {
+        qint64 id;
+        QString peer;
+        QString fileName;
+        QString filePath;
+        qint64 size;
+        bool outgoing;
+        bool completed;
+        QDateTime started;
+        QDateTime finished;
+        QByteArray hash;
+    };
+
 public:
     History(const QString& profileName, const QString& password);
     History(const QString& profileName, const QString& password, const HistoryKeeper& oldHistory);
@@ -47,7 +61,20 @@ public:
                        std::function<void(int64_t)> insertIdCallback={});
 
     QList<HistMessage> getChatHistory(const QString& friendPk, const QDateTime &from, const QDateTime &to);
+    QList<HistMessage> getChatHistoryPage(const QString& friendPk, const QDateTime& from,
+                                          const QDateTime& before, qint64 beforeId, int limit);
+    QDateTime getDateWhereFindPhrase(const QString& friendPk, const QDateTime& before, QString phrase);
     void markAsSent(qint64 id);
+
+    QByteArray getAvatar(const QString& ownerPk);
+    void setAvatar(const QString& ownerPk, const QByteArray& pic);
+    void importAvatar(const QString& ownerPk, const QByteArray& pic);
+    void removeAvatar(const QString& ownerPk);
+
+    void addFileTransfer(const FileTransfer& transfer, std::function<void(int64_t)> insertIdCallback={});
+    void setFileTransferHash(int64_t id, const QByteArray& hash);
+    QList<FileTransfer> getFileTransfers();
+
     static QString getDbPath(const QString& profileName);
 protected:
     void init();
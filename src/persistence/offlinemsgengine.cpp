@@ -32,6 +32,15 @@
 Originally was 2s, but since that was causing lots of duplicated
 messages on receiving end, make qTox be more lazy about re-sending
 should be 20s.
+
+@var QHash<const ChatMessage*, QPair<ChatMessage::Ptr, int64_t>> OfflineMsgEngine::pendingIds
+@brief History ids of messages the core hasn't finished sending yet.
+
+If the core drops its queue, the entry stays here and the history row stays
+unsent, so the message is resent the next time the history is loaded.
+
+@var QHash<const ChatMessage*, QPair<ChatMessage::Ptr, int>> OfflineMsgEngine::pendingReceipts
+@brief Receipts of sent messages whose history id isn't known yet.
 */
 
 
@@ -77,6 +86,51 @@ void OfflineMsgEngine::registerReceipt(int receipt, int64_t messageID, ChatMessa
     undeliveredMsgs[messageID] = {msg, timestamp, receipt};
 }
 
+/**
+@brief Records the history id of a message, once it's written.
+@param msg Message that was written to the history.
+@param messageID Its id in the history.
+
+The id and the receipt of a message come from different threads in any order,
+the receipt is registered once both are known.
+*/
+void OfflineMsgEngine::registerMessageId(ChatMessage::Ptr msg, int64_t messageID)
+{
+    QMutexLocker ml(&mutex);
+
+    auto it = pendingReceipts.find(msg.get());
+    if (it == pendingReceipts.end())
+    {
+        pendingIds.insert(msg.get(), qMakePair(msg, messageID));
+        return;
+    }
+
+    int receipt = it.value().second;
+    pendingReceipts.erase(it);
+    registerReceipt(receipt, messageID, msg);
+}
+
+/**
+@brief Records the receipt of a message, once the core sent its last chunk.
+@param msg Message that was sent.
+@param receipt Receipt of its last chunk.
+*/
+void OfflineMsgEngine::registerSentReceipt(ChatMessage::Ptr msg, int receipt)
+{
+    QMutexLocker ml(&mutex);
+
+    auto it = pendingIds.find(msg.get());
+    if (it == pendingIds.end())
+    {
+        pendingReceipts.insert(msg.get(), qMakePair(msg, receipt));
+        return;
+    }
+
+    int64_t messageID = it.value().second;
+    pendingIds.erase(it);
+    registerReceipt(receipt, messageID, msg);
+}
+
 void OfflineMsgEngine::deliverOfflineMsgs()
 {
     QMutexLocker ml(&mutex);
@@ -105,13 +159,12 @@ void OfflineMsgEngine::deliverOfflineMsgs()
             continue;
         }
         QString messageText = val.msg->toString();
-        int rec;
-        if (val.msg->isAction())
-            rec = Core::getInstance()->sendAction(f->getFriendID(), messageText);
-        else
-            rec = Core::getInstance()->sendMessage(f->getFriendID(), messageText);
-
-        registerReceipt(rec, key, val.msg);
+        ChatMessage::Ptr msg = val.msg;
+        Core::getInstance()->queueMessage(f->getFriendID(), messageText, msg->isAction(),
+                                          [this, key, msg](int rec)
+        {
+            registerReceipt(rec, key, msg);
+        });
     }
 }
 
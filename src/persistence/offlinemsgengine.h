@@ -40,6 +40,8 @@ public:
 
     void dischargeReceipt(int receipt);
     void registerReceipt(int receipt, int64_t messageID, ChatMessage::Ptr msg, const QDateTime &timestamp = QDateTime::currentDateTime());
+    void registerMessageId(ChatMessage::Ptr msg, int64_t messageID);
+    void registerSentReceipt(ChatMessage::Ptr msg, int receipt);
 
 public slots:
     void deliverOfflineMsgs();
@@ -56,6 +58,8 @@ private:
     Friend* f;
     QHash<int, int64_t> receipts;
     QMap<int64_t, MsgPtr> undeliveredMsgs;
+    QHash<const ChatMessage*, QPair<ChatMessage::Ptr, int64_t>> pendingIds;
+    QHash<const ChatMessage*, QPair<ChatMessage::Ptr, int>> pendingReceipts;
 
     static const int offlineTimeout;
 };
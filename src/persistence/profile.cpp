@@ -29,10 +29,12 @@
 #include <cassert>
 #include <QDir>
 #include <QFileInfo>
+#include <QHash>
 #include <QSaveFile>
 #include <QThread>
 #include <QObject>
 #include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
 #include <sodium.h>
 
 /**
@@ -45,6 +47,21 @@
 @var bool Profile::isRemoved
 @brief True if the profile has been removed by remove().
 
+@var QByteArray Profile::pendingSaveData
+@brief Latest .tox save waiting to be written, empty if there's none.
+
+@var QThreadPool Profile::saveThread
+@brief Single thread writing the .tox saves, in order.
+
+@class Profile::Unlock
+@brief State of a profile being unlocked by unlockProfile(), possibly on another thread.
+
+@var std::atomic_bool Profile::Unlock::cancelled
+@brief Set to stop the unlock before its next stage.
+
+@var bool Profile::Unlock::wrongPassword
+@brief True if the unlock failed because the password was wrong.
+
 @var static constexpr int Profile::encryptHeaderSize = 8
 @brief How much data we need to read to check if the file is encrypted.
 @note Must be >= TOX_ENC_SAVE_MAGIC_LENGTH (8), which isn't publicly defined.
@@ -52,12 +69,45 @@
 
 QVector<QString> Profile::profiles;
 
+/**
+@brief Derives a key with a fresh salt, to encrypt the saves of a profile.
+@param password Profile password, no key is derived if it's empty.
+*/
+static TOX_PASS_KEY derivePasskey(const QString& password)
+{
+    if (password.isEmpty())
+        return TOX_PASS_KEY{};
+
+    return *Core::createPasskey(password);
+}
+
+/**
+@brief Opens the history database of a profile.
+@return The history, or nullptr if it couldn't be opened.
+*/
+static std::unique_ptr<History> openHistory(const QString& name, const QString& password)
+{
+    std::unique_ptr<History> history{new History{name, password}};
+    if (!history->isValid())
+    {
+        qWarning() << "Failed to open history for profile"<<name;
+        history.release();
+    }
+
+    return history;
+}
+
 Profile::Profile(QString name, const QString &password, bool isNewProfile)
-    : name{name}, password{password},
+    : Profile{name, password, isNewProfile, derivePasskey(password), openHistory(name, password)}
+{
+}
+
+Profile::Profile(QString name, const QString &password, bool isNewProfile,
+                 const TOX_PASS_KEY& passkey, std::unique_ptr<History> history)
+    : name{name}, password{password}, passkey(passkey), history{std::move(history)},
       newProfile{isNewProfile}, isRemoved{false}
 {
-    if (!password.isEmpty())
-        passkey = *core->createPasskey(password);
+    saveThread.setMaxThreadCount(1);
 
     Settings& s = Settings::getInstance();
     s.setCurrentProfile(name);
@@ -65,13 +115,8 @@ Profile::Profile(QString name, const QString &password, bool isNewProfile)
 
     // At this point it's too early to load the personal settings (Nexus will do it), so we always load
     // the history, and if it fails we can't change the setting now, but we keep a nullptr
-    history.reset(new History{name, password});
-    if (!history->isValid())
-    {
-        qWarning() << "Failed to open history for profile"<<name;
+    if (!this->history)
         GUI::showError(QObject::tr("Error"), QObject::tr("qTox couldn't open your chat logs, they will be disabled."));
-        history.release();
-    }
 
     coreThread = new QThread();
     coreThread->setObjectName("qTox Core");
@@ -102,65 +147,124 @@ Profile* Profile::loadProfile(QString name, const QString &password)
         return nullptr;
     }
 
-    // Check password
+    Unlock unlock;
+    unlock.name = name;
+    unlock.password = password;
+    if (!unlockProfile(unlock))
     {
-        QString path = Settings::getInstance().getSettingsDirPath() + name + ".tox";
-        QFile saveFile(path);
-        qDebug() << "Loading tox save "<<path;
+        ProfileLocker::unlock();
+        return nullptr;
+    }
 
-        if (!saveFile.exists())
-        {
-            qWarning() << "The tox save file "<<path<<" was not found";
-            ProfileLocker::unlock();
-            return nullptr;
-        }
+    return loadUnlockedProfile(unlock);
+}
 
-        if (!saveFile.open(QIODevice::ReadOnly))
-        {
-            qCritical() << "The tox save file " << path << " couldn't' be opened";
-            ProfileLocker::unlock();
-            return nullptr;
-        }
+/**
+@brief Checks the password of a profile and does the slow part of loading it.
+@param unlock Profile to unlock, receives the derived key and opened history.
+@return True on success, false on error, on a wrong password or when cancelled.
 
-        qint64 fileSize = saveFile.size();
-        if (fileSize <= 0)
-        {
-            qWarning() << "The tox save file"<<path<<" is empty!";
-            ProfileLocker::unlock();
-            return nullptr;
-        }
+Derives the keys and opens the history database, which can take seconds for an
+encrypted profile. It's safe to call on a worker thread, the profile must be
+locked by the caller. A wrong password is rejected before any other work.
+
+The unlock can be cancelled at any time by setting Unlock::cancelled, it stops
+before the next stage. Unlock::stageChanged, if set, is called on the calling
+thread when a stage starts.
+*/
+bool Profile::unlockProfile(Unlock& unlock)
+{
+    auto enterStage = [&unlock](UnlockStage stage)
+    {
+        if (unlock.cancelled)
+            return false;
+
+        if (unlock.stageChanged)
+            unlock.stageChanged(stage);
 
-        QByteArray data = saveFile.readAll();
-        if (tox_is_data_encrypted((uint8_t*)data.data()))
+        return true;
+    };
+
+    const QString& password = unlock.password;
+    QString path = Settings::getInstance().getSettingsDirPath() + unlock.name + ".tox";
+    QFile saveFile(path);
+    qDebug() << "Loading tox save "<<path;
+
+    if (!saveFile.exists())
+    {
+        qWarning() << "The tox save file "<<path<<" was not found";
+        return false;
+    }
+
+    if (!saveFile.open(QIODevice::ReadOnly))
+    {
+        qCritical() << "The tox save file " << path << " couldn't' be opened";
+        return false;
+    }
+
+    qint64 fileSize = saveFile.size();
+    if (fileSize <= 0)
+    {
+        qWarning() << "The tox save file"<<path<<" is empty!";
+        return false;
+    }
+
+    QByteArray data = saveFile.readAll();
+    if (tox_is_data_encrypted((uint8_t*)data.data()))
+    {
+        if (password.isEmpty())
         {
-            if (password.isEmpty())
-            {
-                qCritical() << "The tox save file is encrypted, but we don't have a password!";
-                ProfileLocker::unlock();
-                return nullptr;
-            }
-
-            uint8_t salt[TOX_PASS_SALT_LENGTH];
-            tox_get_salt(reinterpret_cast<uint8_t *>(data.data()), salt);
-            auto tmpkey = *Core::createPasskey(password, salt);
-
-            data = Core::decryptData(data, tmpkey);
-            if (data.isEmpty())
-            {
-                qCritical() << "Failed to decrypt the tox save file";
-                ProfileLocker::unlock();
-                return nullptr;
-            }
+            qCritical() << "The tox save file is encrypted, but we don't have a password!";
+            unlock.wrongPassword = true;
+            return false;
         }
-        else
+
+        if (!enterStage(UnlockStage::CheckingPassword))
+            return false;
+
+        uint8_t salt[TOX_PASS_SALT_LENGTH];
+        tox_get_salt(reinterpret_cast<uint8_t *>(data.data()), salt);
+        auto tmpkey = *Core::createPasskey(password, salt);
+
+        data = Core::decryptData(data, tmpkey);
+        if (data.isEmpty())
         {
-            if (!password.isEmpty())
-                qWarning() << "We have a password, but the tox save file is not encrypted";
+            qCritical() << "Failed to decrypt the tox save file";
+            unlock.wrongPassword = true;
+            return false;
         }
     }
+    else
+    {
+        if (!password.isEmpty())
+            qWarning() << "We have a password, but the tox save file is not encrypted";
+    }
+
+    if (!password.isEmpty())
+    {
+        if (!enterStage(UnlockStage::PreparingKeys))
+            return false;
+
+        unlock.passkey = derivePasskey(password);
+    }
+
+    if (!enterStage(UnlockStage::OpeningHistory))
+        return false;
 
-    Profile* p = new Profile(name, password, false);
-    if (p->history && HistoryKeeper::isFileExist(!password.isEmpty()))
+    unlock.history = openHistory(unlock.name, password);
+    return !unlock.cancelled;
+}
+
+/**
+@brief Creates the profile and its Core* instance, from the result of unlockProfile().
+@param unlock Successfully unlocked profile, its history is moved to the new profile.
+@return The loaded profile.
+@note Must be called on the GUI thread.
+*/
+Profile* Profile::loadUnlockedProfile(Unlock& unlock)
+{
+    Profile* p = new Profile(unlock.name, unlock.password, false, unlock.passkey, std::move(unlock.history));
+    if (p->history && HistoryKeeper::isFileExist(!unlock.password.isEmpty()))
         p->history->import(*HistoryKeeper::getInstance(*p));
     return p;
 }
@@ -203,6 +307,7 @@ Profile::~Profile()
         saveToxSave();
     delete core;
     delete coreThread;
+    flushToxSave();
     if (!isRemoved)
     {
         Settings::getInstance().savePersonal(this);
@@ -350,11 +455,67 @@ void Profile::saveToxSave()
 }
 
 /**
-@brief Write the .tox save, encrypted if needed.
+@brief Write the .tox save, encrypted if needed, and wait until it's written.
 @param data Byte array of profile save.
 @warning Invalid on deleted profiles.
 */
 void Profile::saveToxSave(QByteArray data)
+{
+    saveToxSaveLater(data);
+    flushToxSave();
+}
+
+/**
+@brief Write the .tox save in the background, encrypted if needed.
+@param data Byte array of profile save.
+
+Encrypting re-derives the key, which is slow on purpose, so it's done off the calling
+thread. Saves requested while a write is waiting replace its data, a burst of changes
+thus only causes a single write.
+@warning Invalid on deleted profiles.
+*/
+void Profile::saveToxSaveLater(QByteArray data)
+{
+    QMutexLocker locker{&pendingSaveMutex};
+    bool writeQueued = !pendingSaveData.isEmpty();
+    pendingSaveData = data;
+    pendingSavePassword = password;
+
+    if (!writeQueued)
+        QtConcurrent::run(&saveThread, [this]() { writePendingToxSave(); });
+}
+
+/**
+@brief Waits until the requested .tox saves are written.
+*/
+void Profile::flushToxSave()
+{
+    saveThread.waitForDone();
+}
+
+/**
+@brief Writes the latest requested .tox save, runs on the save thread.
+*/
+void Profile::writePendingToxSave()
+{
+    QByteArray data;
+    QString savePassword;
+    {
+        QMutexLocker locker{&pendingSaveMutex};
+        data.swap(pendingSaveData);
+        savePassword = pendingSavePassword;
+    }
+
+    if (!data.isEmpty())
+        writeToxSave(data, savePassword);
+}
+
+/**
+@brief Writes the .tox save file.
+@param data Byte array of profile save.
+@param savePassword Password to encrypt it with, if any.
+*/
+void Profile::writeToxSave(QByteArray data, const QString& savePassword)
 {
     assert(!isRemoved);
     ProfileLocker::assertLock();
@@ -369,10 +530,9 @@ void Profile::saveToxSave(QByteArray data)
         return;
     }
 
-    if (!password.isEmpty())
+    if (!savePassword.isEmpty())
     {
-        passkey = *core->createPasskey(password);
-        data = core->encryptData(data, passkey);
+        data = Core::encryptData(data, *Core::createPasskey(savePassword));
         if (data.isEmpty())
         {
             qCritical() << "Failed to encrypt, can't save!";
@@ -455,8 +615,35 @@ QByteArray Profile::loadAvatarData(const QString &ownerId)
 @param ownerId Friend ID to load avatar.
 @param password Profile password to decrypt data.
 @return Avatar as QByteArray.
+
+Avatars are kept in the profile database, encrypted along with it.
+Avatar files cached before that are moved into the database on first read.
 */
 QByteArray Profile::loadAvatarData(const QString &ownerId, const QString &password)
+{
+    if (!history)
+        return loadAvatarFile(ownerId, password);
+
+    QByteArray pic = history->getAvatar(ownerId);
+    if (!pic.isEmpty())
+        return pic;
+
+    pic = loadAvatarFile(ownerId, password);
+    if (!pic.isEmpty())
+    {
+        history->setAvatar(ownerId, pic);
+        removeAvatarFile(ownerId);
+    }
+    return pic;
+}
+
+/**
+@brief Get a contact's avatar from its file in the avatars directory.
+@param ownerId Friend ID to load avatar.
+@param password Profile password to decrypt data.
+@return Avatar as QByteArray.
+*/
+QByteArray Profile::loadAvatarFile(const QString &ownerId, const QString &password)
 {
     QString path = avatarPath(ownerId);
     bool encrypted = !password.isEmpty();
@@ -483,6 +670,59 @@ QByteArray Profile::loadAvatarData(const QString &ownerId, const QString &passwo
     return pic;
 }
 
+/**
+@brief Removes a contact's avatar files, encrypted or not.
+@param ownerId Friend ID whose avatar files to delete.
+*/
+void Profile::removeAvatarFile(const QString &ownerId)
+{
+    QFile::remove(avatarPath(ownerId));
+    if (!password.isEmpty())
+        QFile::remove(avatarPath(ownerId, true));
+}
+
+/**
+@brief Moves every avatar file left from before the database cache into the history.
+
+Lists the avatars directory once instead of probing the files of each friend.
+Files are named after their owner, or a hash of it on encrypted profiles, which
+is only computed for the friends when files are left. Encrypted files of
+non-friends can't be told apart and are left alone.
+*/
+void Profile::importAvatarFiles()
+{
+    QDir dir(Settings::getInstance().getSettingsDirPath() + "avatars/");
+    QStringList files = dir.entryList(QStringList{"*.png"}, QDir::Files);
+    if (files.isEmpty())
+        return;
+
+    QHash<QString, QString> owners;
+    if (!password.isEmpty())
+    {
+        for (uint32_t friendId : core->getFriendList())
+        {
+            QString friendPublicKey = core->getFriendPublicKey(friendId);
+            owners[QFileInfo(avatarPath(friendPublicKey)).completeBaseName()] = friendPublicKey;
+            owners[friendPublicKey] = friendPublicKey;
+        }
+    }
+
+    for (const QString& file : files)
+    {
+        QString baseName = QFileInfo(file).completeBaseName();
+        QString ownerId = password.isEmpty() ? baseName : owners.value(baseName);
+        if (ownerId.isEmpty())
+            continue;
+
+        QByteArray pic = loadAvatarFile(ownerId, password);
+        if (pic.isEmpty())
+            continue;
+
+        history->importAvatar(ownerId, pic);
+        removeAvatarFile(ownerId);
+    }
+}
+
 /**
 @brief Save an avatar to cache.
 @param pic Picture to save.
@@ -490,6 +730,15 @@ QByteArray Profile::loadAvatarData(const QString &ownerId, const QString &passwo
 */
 void Profile::saveAvatar(QByteArray pic, const QString &ownerId)
 {
+    if (history)
+    {
+        if (pic.isEmpty())
+            history->removeAvatar(ownerId);
+        else
+            history->setAvatar(ownerId, pic);
+        return;
+    }
+
     if (!password.isEmpty() && !pic.isEmpty())
         pic = core->encryptData(pic, passkey);
 
@@ -557,6 +806,9 @@ History *Profile::getHistory()
 */
 void Profile::removeAvatar(const QString &ownerId)
 {
+    if (history)
+        history->removeAvatar(ownerId);
+
     QFile::remove(avatarPath(ownerId));
     if (ownerId == core->getSelfId().publicKey)
         core->setAvatar({});
@@ -613,6 +865,14 @@ QVector<QString> Profile::remove()
         qWarning() << "Profile " << name << " is already removed!";
         return {};
     }
+
+    // drop the saves that weren't written yet
+    {
+        QMutexLocker locker{&pendingSaveMutex};
+        pendingSaveData.clear();
+    }
+    flushToxSave();
+
     isRemoved = true;
 
     qDebug() << "Removing profile" << name;
@@ -736,6 +996,11 @@ void Profile::restartCore()
 void Profile::setPassword(const QString &newPassword)
 {
     QByteArray avatar = loadAvatarData(core->getSelfId().publicKey);
+
+    // Avatars in the database are re-encrypted with it, leftover files are read with the old password
+    if (history)
+        importAvatarFiles();
+
     QString oldPassword = password;
     password = newPassword;
     passkey = *core->createPasskey(password);
@@ -748,6 +1013,9 @@ void Profile::setPassword(const QString &newPassword)
     }
     saveAvatar(avatar, core->getSelfId().publicKey);
 
+    if (history)
+        return;
+
     QVector<uint32_t> friendList = core->getFriendList();
     QVectorIterator<uint32_t> i(friendList);
     while (i.hasNext())
@@ -25,7 +25,11 @@
 #include <QString>
 #include <QByteArray>
 #include <QPixmap>
+#include <QMutex>
+#include <QThreadPool>
 #include <tox/toxencryptsave.h>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include "src/persistence/history.h"
 
@@ -35,7 +39,27 @@ class QThread;
 class Profile
 {
 public:
+    enum class UnlockStage
+    {
+        CheckingPassword,
+        PreparingKeys,
+        OpeningHistory,
+    };
+
+    struct Unlock
+    {
+        QString name;
+        QString password;
+        std::function<void(UnlockStage)> stageChanged;
+        std::atomic_bool cancelled{false};
+        bool wrongPassword = false;
+        TOX_PASS_KEY passkey{};
+        std::unique_ptr<History> history;
+    };
+
     static Profile* loadProfile(QString name, const QString &password = QString());
+    static bool unlockProfile(Unlock& unlock);
+    static Profile* loadUnlockedProfile(Unlock& unlock);
     static Profile* createProfile(QString name, QString password);
     ~Profile();
 
@@ -54,6 +78,8 @@ public:
     QByteArray loadToxSave();
     void saveToxSave();
     void saveToxSave(QByteArray data);
+    void saveToxSaveLater(QByteArray data);
+    void flushToxSave();
 
     QPixmap loadAvatar();
     QPixmap loadAvatar(const QString& ownerId);
@@ -79,8 +105,15 @@ public:
 
 private:
     Profile(QString name, const QString &password, bool newProfile);
+    Profile(QString name, const QString &password, bool newProfile,
+            const TOX_PASS_KEY& passkey, std::unique_ptr<History> history);
     static QVector<QString> getFilesByExt(QString extension);
     QString avatarPath(const QString& ownerId, bool forceUnencrypted = false);
+    QByteArray loadAvatarFile(const QString& ownerId, const QString& password);
+    void removeAvatarFile(const QString& ownerId);
+    void importAvatarFiles();
+    void writePendingToxSave();
+    void writeToxSave(QByteArray data, const QString& savePassword);
 
 private:
     Core* core;
@@ -90,6 +123,10 @@ private:
     std::unique_ptr<History> history;
     bool newProfile;
     bool isRemoved;
+    QMutex pendingSaveMutex;
+    QByteArray pendingSaveData;
+    QString pendingSavePassword;
+    QThreadPool saveThread;
     static QVector<QString> profiles;
     static constexpr int encryptHeaderSize = 8;
 };
@@ -260,6 +260,7 @@ void Settings::loadGlobal()
         outDev = s.value("outDev", "").toString();
         audioOutDevEnabled = s.value("audioOutDevEnabled", true).toBool();
         audioInGainDecibel = s.value("inGain", 0).toReal();
+        audioProfile = s.value("audioProfile", 0).toInt();
         outVolume = s.value("outVolume", 100).toInt();
     s.endGroup();
 
@@ -503,6 +504,7 @@ void Settings::saveGlobal()
         s.setValue("outDev", outDev);
         s.setValue("audioOutDevEnabled", audioOutDevEnabled);
         s.setValue("inGain", audioInGainDecibel);
+        s.setValue("audioProfile", audioProfile);
         s.setValue("outVolume", outVolume);
     s.endGroup();
 
@@ -1457,6 +1459,18 @@ void Settings::setAudioInGain(qreal dB)
     audioInGainDecibel = dB;
 }
 
+int Settings::getAudioProfile() const
+{
+    QMutexLocker locker{&bigLock};
+    return audioProfile;
+}
+
+void Settings::setAudioProfile(int type)
+{
+    QMutexLocker locker{&bigLock};
+    audioProfile = type;
+}
+
 QString Settings::getVideoDev() const
 {
     QMutexLocker locker{&bigLock};
@@ -190,6 +190,9 @@ public:
     qreal getAudioInGain() const;
     void setAudioInGain(qreal dB);
 
+    int getAudioProfile() const;
+    void setAudioProfile(int type);
+
     int getOutVolume() const;
     void setOutVolume(int volume);
 
@@ -442,6 +445,7 @@ private:
     QString inDev;
     bool audioInDevEnabled;
     qreal audioInGainDecibel;
+    int audioProfile;
     QString outDev;
     bool audioOutDevEnabled;
     int outVolume;
@@ -0,0 +1,281 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cameracache.h"
+#include "cameradevice.h"
+#include "src/persistence/settings.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+
+#ifdef Q_OS_WIN
+#include <objbase.h>
+#endif
+
+/**
+@class CameraCache
+@brief Remembers the camera devices and their video modes, so that we never wait on probing.
+
+Probing every mode of a camera can take seconds of ioctls on some devices,
+so it's done in the background and the results are saved between runs.
+Until a probe finishes, the devices and modes found last time are returned.
+Modes are keyed by device identity, the short name and the description together,
+so that another camera taking over the same device node doesn't inherit stale modes.
+
+@var QFileSystemWatcher CameraCache::hotplugWatcher
+@brief Watches the device directory to refresh the cache when a camera is plugged or unplugged.
+
+@var QTimer CameraCache::hotplugTimer
+@brief Lets a burst of device node changes settle before refreshing.
+*/
+
+/**
+@fn void CameraCache::devicesChanged()
+@brief Emitted on the GUI thread when a refresh found different devices or modes.
+*/
+
+/**
+@brief Returns the singleton instance.
+*/
+CameraCache& CameraCache::getInstance()
+{
+    static CameraCache instance;
+    return instance;
+}
+
+CameraCache::CameraCache()
+    : probeWatcher{this}
+    , hotplugWatcher{this}
+    , hotplugTimer{this}
+{
+    // We can be first used from any thread, e.g. the CoreAV thread, but we need the
+    // GUI event loop for the watchers, they're our children so they move along with us
+    moveToThread(qApp->thread());
+
+    hotplugTimer.setSingleShot(true);
+    hotplugTimer.setInterval(1000);
+    connect(&hotplugTimer, &QTimer::timeout, this, &CameraCache::refresh);
+
+#ifdef Q_OS_LINUX
+    hotplugWatcher.addPath("/dev");
+    connect(&hotplugWatcher, &QFileSystemWatcher::directoryChanged,
+            &hotplugTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+#endif
+
+    connect(&probeWatcher, &QFutureWatcher<Probe>::finished, this, &CameraCache::onProbeFinished);
+
+    load();
+    QMetaObject::invokeMethod(this, "refresh", Qt::QueuedConnection);
+}
+
+/**
+@brief Get the cached list of video devices.
+@return List of (short name, description) pairs, empty if we never probed them yet.
+*/
+QVector<QPair<QString, QString>> CameraCache::getDeviceList()
+{
+    QMutexLocker locker{&cacheLock};
+    return devices;
+}
+
+/**
+@brief Get the cached video modes of a device.
+@param devName Short name of the device.
+@return Video modes, empty if the device wasn't probed yet.
+
+Screen modes are cheap to get and follow the display configuration, so they are never cached.
+*/
+QVector<VideoMode> CameraCache::getVideoModes(const QString& devName)
+{
+    if (CameraDevice::isScreen(devName))
+        return CameraDevice::getVideoModes(devName);
+
+    QMutexLocker locker{&cacheLock};
+    for (const QPair<QString, QString>& device : devices)
+    {
+        if (device.first == devName)
+            return modes.value(deviceKey(device));
+    }
+
+    return {};
+}
+
+/**
+@brief Probes the devices and their modes again in the background.
+*/
+void CameraCache::refresh()
+{
+    if (QThread::currentThread() != thread())
+        return (void)QMetaObject::invokeMethod(this, "refresh", Qt::QueuedConnection);
+
+    if (probeWatcher.isRunning())
+        return;
+
+    probeWatcher.setFuture(QtConcurrent::run(&CameraCache::probe));
+}
+
+/**
+@brief Lists the devices and probes their modes, the slow part of the cache.
+@note Runs on a worker thread.
+*/
+CameraCache::Probe CameraCache::probe()
+{
+#ifdef Q_OS_WIN
+    // DirectShow needs COM, which the thread pool's threads don't initialize
+    HRESULT comInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+
+    Probe result;
+    result.devices = CameraDevice::getDeviceList();
+
+    for (const QPair<QString, QString>& device : result.devices)
+    {
+        if (device.first == "none" || CameraDevice::isScreen(device.first))
+            continue;
+
+        result.modes[deviceKey(device)] = CameraDevice::getVideoModes(device.first);
+    }
+
+#ifdef Q_OS_WIN
+    if (SUCCEEDED(comInit))
+        CoUninitialize();
+#endif
+
+    return result;
+}
+
+/**
+@brief Takes the result of a probe, unless it lost every camera we knew about.
+
+A probe that fails to enumerate the cameras still finds the "none" and desktop
+devices, so finding no camera at all keeps the cached ones rather than saving
+that list over them.
+*/
+void CameraCache::onProbeFinished()
+{
+    Probe result = probeWatcher.result();
+
+    {
+        QMutexLocker locker{&cacheLock};
+        if (result.devices == devices && result.modes == modes)
+            return;
+
+        if (countCameras(result.devices) == 0 && countCameras(devices) > 0)
+        {
+            qWarning() << "Found no camera, keeping the cached ones";
+            return;
+        }
+
+        devices = result.devices;
+        modes = result.modes;
+    }
+
+    save();
+    emit devicesChanged();
+}
+
+/**
+@brief Counts the actual cameras of a device list, leaving out "none" and the screens.
+*/
+int CameraCache::countCameras(const QVector<QPair<QString, QString>>& devices)
+{
+    int count = 0;
+    for (const QPair<QString, QString>& device : devices)
+    {
+        if (device.first != "none" && !CameraDevice::isScreen(device.first))
+            ++count;
+    }
+
+    return count;
+}
+
+QString CameraCache::deviceKey(const QPair<QString, QString>& device)
+{
+    return device.first + '\n' + device.second;
+}
+
+QString CameraCache::getCachePath()
+{
+    return Settings::getInstance().getSettingsDirPath() + "cameras.ini";
+}
+
+/**
+@brief Loads the devices and modes saved by a previous run.
+*/
+void CameraCache::load()
+{
+    QSettings ini(getCachePath(), QSettings::IniFormat);
+
+    QMutexLocker locker{&cacheLock};
+    int deviceCount = ini.beginReadArray("Devices");
+    for (int i = 0; i < deviceCount; ++i)
+    {
+        ini.setArrayIndex(i);
+        QPair<QString, QString> device{ini.value("name").toString(), ini.value("description").toString()};
+        devices.append(device);
+
+        QVector<VideoMode>& deviceModes = modes[deviceKey(device)];
+        int modeCount = ini.beginReadArray("Modes");
+        for (int j = 0; j < modeCount; ++j)
+        {
+            ini.setArrayIndex(j);
+            VideoMode mode(ini.value("width").toInt(), ini.value("height").toInt(), 0, 0,
+                           0, ini.value("pixelFormat").toUInt());
+            mode.FPS = ini.value("fps").toFloat();
+            deviceModes.append(mode);
+        }
+        ini.endArray();
+    }
+    ini.endArray();
+}
+
+/**
+@brief Saves the devices and modes for the next run.
+*/
+void CameraCache::save()
+{
+    QSettings ini(getCachePath(), QSettings::IniFormat);
+    ini.clear();
+
+    QMutexLocker locker{&cacheLock};
+    ini.beginWriteArray("Devices", devices.size());
+    for (int i = 0; i < devices.size(); ++i)
+    {
+        ini.setArrayIndex(i);
+        ini.setValue("name", devices[i].first);
+        ini.setValue("description", devices[i].second);
+
+        const QVector<VideoMode> deviceModes = modes.value(deviceKey(devices[i]));
+        ini.beginWriteArray("Modes", deviceModes.size());
+        for (int j = 0; j < deviceModes.size(); ++j)
+        {
+            ini.setArrayIndex(j);
+            ini.setValue("width", deviceModes[j].width);
+            ini.setValue("height", deviceModes[j].height);
+            ini.setValue("fps", deviceModes[j].FPS);
+            ini.setValue("pixelFormat", deviceModes[j].pixel_format);
+        }
+        ini.endArray();
+    }
+    ini.endArray();
+}
@@ -0,0 +1,79 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CAMERACACHE_H
+#define CAMERACACHE_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include "videomode.h"
+
+class CameraCache : public QObject
+{
+    Q_OBJECT
+public:
+    static CameraCache& getInstance();
+
+    QVector<QPair<QString, QString>> getDeviceList();
+    QVector<VideoMode> getVideoModes(const QString& devName);
+
+public slots:
+    void refresh();
+
+signals:
+    void devicesChanged();
+
+private:
+    struct Probe
+    {
+        QVector<QPair<QString, QString>> devices;
+        QHash<QString, QVector<VideoMode>> modes;
+    };
+
+    CameraCache();
+
+    static Probe probe();
+    static int countCameras(const QVector<QPair<QString, QString>>& devices);
+    static QString deviceKey(const QPair<QString, QString>& device);
+    static QString getCachePath();
+
+    void load();
+    void save();
+
+private slots:
+    void onProbeFinished();
+
+private:
+    QMutex cacheLock;
+    QVector<QPair<QString, QString>> devices;
+    QHash<QString, QVector<VideoMode>> modes;
+    QFutureWatcher<Probe> probeWatcher;
+    QFileSystemWatcher hotplugWatcher;
+    QTimer hotplugTimer;
+};
+
+#endif // CAMERACACHE_H
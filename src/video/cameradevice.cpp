@@ -26,6 +26,7 @@ extern "C" {
 #include <libavdevice/avdevice.h>
 }
 #include "cameradevice.h"
+#include "cameracache.h"
 #include "src/persistence/settings.h"
 
 #ifdef Q_OS_WIN
@@ -395,6 +396,7 @@ QVector<QPair<QString, QString>> CameraDevice::getDeviceList()
 @brief Get the default device name.
 @return The short name of the default device
 This is either the device in the settings or the system default.
+Uses the cached device list, so it never waits on probing the devices.
 */
 QString CameraDevice::getDefaultDeviceName()
 {
@@ -403,7 +405,7 @@ QString CameraDevice::getDefaultDeviceName()
     if (!getDefaultInputFormat())
         return defaultdev;
 
-    QVector<QPair<QString, QString>> devlist = getDeviceList();
+    QVector<QPair<QString, QString>> devlist = CameraCache::getInstance().getDeviceList();
     for (const QPair<QString,QString>& device : devlist)
         if (defaultdev == device.first)
             return defaultdev;
@@ -22,6 +22,7 @@ extern "C" {
 #include <libavdevice/avdevice.h>
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
+#include <libavutil/pixdesc.h>
 }
 #include <QMutexLocker>
 #include <QDebug>
@@ -29,6 +30,7 @@ extern "C" {
 #include <memory>
 #include <functional>
 #include "src/persistence/settings.h"
+#include "src/allocstats.h"
 #include "camerasource.h"
 #include "cameradevice.h"
 #include "videoframe.h"
@@ -82,6 +84,18 @@ open but the device closed if there are zero subscribers.
 
 @var std::atomic_int CameraSource::subscriptions
 @brief Remember how many times we subscribed for RAII
+
+@var std::atomic_int CameraSource::pausedSubscriptions
+@brief How many of the subscriptions don't need frames for now
+
+@var bool CameraSource::screenCapture
+@brief True when the device captures the screen as raw frames, see isScreenFrameWanted
+
+@var bool CameraSource::screenChangePending
+@brief A changed screen frame was dropped and the change hasn't been sent yet
+
+@var qint64 CameraSource::lastScreenFrame
+@brief Time of the last screen frame we decoded, according to screenTimer
 */
 
 CameraSource* CameraSource::instance{nullptr};
@@ -89,7 +103,9 @@ CameraSource* CameraSource::instance{nullptr};
 CameraSource::CameraSource()
     : deviceName{"none"}, device{nullptr}, mode(VideoMode()),
       cctx{nullptr}, cctxOrig{nullptr}, videoStreamIndex{-1},
-      _isOpen{false}, streamBlocker{false}, subscriptions{0}
+      _isOpen{false}, streamBlocker{false}, subscriptions{0},
+      pausedSubscriptions{0}, screenCapture{false}, screenChangePending{false},
+      lastScreenFrame{0}
 {
     subscriptions = 0;
     av_register_all();
@@ -279,6 +295,22 @@ void CameraSource::unsubscribe()
     subscriptions--;
 }
 
+/**
+@brief Pauses one subscription.
+
+While all subscriptions are paused the device stays open, but the
+streaming thread drops the captured packets instead of decoding them.
+*/
+void CameraSource::pause()
+{
+    ++pausedSubscriptions;
+}
+
+void CameraSource::resume()
+{
+    --pausedSubscriptions;
+}
+
 /**
 @brief Opens the video device and starts streaming.
 @note Callers must own the biglock.
@@ -344,6 +376,13 @@ bool CameraSource::openDevice()
 
     cctx->refcounted_frames = 1;
 
+    // Raw screen captures can be compared to skip frames while the screen is static
+    screenCapture = CameraDevice::isScreen(deviceName) && cctx->codec_id == AV_CODEC_ID_RAWVIDEO;
+    screenChangePending = false;
+    screenDetector.reset();
+    screenTimer.start();
+    lastScreenFrame = -SCREEN_IDLE_INTERVAL;
+
     // Open codec
     if (avcodec_open2(cctx, codec, nullptr)<0)
     {
@@ -404,18 +443,37 @@ void CameraSource::closeDevice()
 */
 void CameraSource::stream()
 {
+    ALLOC_SCOPE(Video);
+
     auto streamLoop = [=]()
     {
+        AVPacket packet;
+        if (av_read_frame(device->context, &packet) < 0)
+            return;
+
+        // Keep draining the device while nobody looks, so we resume with fresh frames
+        if (pausedSubscriptions >= subscriptions)
+        {
+            av_packet_unref(&packet);
+            return;
+        }
+
+        if (screenCapture && packet.stream_index == videoStreamIndex
+                && !isScreenFrameWanted(packet))
+        {
+            av_packet_unref(&packet);
+            return;
+        }
+
         AVFrame* frame = av_frame_alloc();
         if (!frame)
+        {
+            av_packet_unref(&packet);
             return;
+        }
 
         frame->opaque = nullptr;
 
-        AVPacket packet;
-        if (av_read_frame(device->context, &packet) < 0)
-            return;
-
         // Only keep packets from the right stream;
         if (packet.stream_index == videoStreamIndex)
         {
@@ -425,6 +483,9 @@ void CameraSource::stream()
             if (!frameFinished)
                 return;
 
+            // Released by the VideoFrame, which gives the size back
+            AllocStats::allocated(AllocStats::Video, VideoFrame::bufferSize(frame));
+
             freelistLock.lock();
 
             int freeFreelistSlot = getFreelistSlotLockless();
@@ -462,6 +523,57 @@ void CameraSource::stream()
     }
 }
 
+/**
+@brief Decides if a captured screen frame is worth decoding and sending.
+@note Callers must own the biglock.
+@param packet Raw screen capture.
+@return False if the frame should be dropped.
+
+While the screen is static, only a keepalive frame is sent every SCREEN_IDLE_INTERVAL ms.
+Small changes like a blinking cursor, under SCREEN_MINOR_PERCENT of the screen, are sent
+at most every SCREEN_MINOR_INTERVAL ms, and anything bigger at the full capture rate.
+*/
+bool CameraSource::isScreenFrameWanted(const AVPacket& packet)
+{
+    QSize size(cctx->width, cctx->height);
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(cctx->pix_fmt);
+    if (!desc || size.isEmpty())
+        return true;
+
+    int bytesPerPixel = av_get_bits_per_pixel(desc) / 8;
+    int stride = packet.size / size.height();
+    if (bytesPerPixel == 0 || stride < size.width() * bytesPerPixel)
+        return true;
+
+    QRegion dirty = screenDetector.update(packet.data, stride, size, bytesPerPixel);
+
+    qint64 interval = SCREEN_IDLE_INTERVAL;
+    if (!dirty.isEmpty())
+    {
+        int dirtyArea = 0;
+        for (const QRect& rect : dirty.rects())
+            dirtyArea += rect.width() * rect.height();
+
+        bool minor = dirtyArea * 100 < size.width() * size.height() * SCREEN_MINOR_PERCENT;
+        interval = minor ? SCREEN_MINOR_INTERVAL : 0;
+    }
+    else if (screenChangePending)
+    {
+        interval = SCREEN_MINOR_INTERVAL;
+    }
+
+    qint64 now = screenTimer.elapsed();
+    if (now - lastScreenFrame < interval)
+    {
+        screenChangePending |= !dirty.isEmpty();
+        return false;
+    }
+
+    lastScreenFrame = now;
+    screenChangePending = false;
+    return true;
+}
+
 /**
 @brief CameraSource::freelistCallback
 @param freelistIndex
@@ -24,12 +24,15 @@
 #include <QString>
 #include <QFuture>
 #include <QVector>
+#include <QElapsedTimer>
 #include <atomic>
 #include "src/video/videosource.h"
 #include "src/video/videomode.h"
+#include "src/video/screenchangedetector.h"
 
 class CameraDevice;
 struct AVCodecContext;
+struct AVPacket;
 
 class CameraSource : public VideoSource
 {
@@ -47,6 +50,8 @@ public:
     // VideoSource interface
     virtual bool subscribe() override;
     virtual void unsubscribe() override;
+    virtual void pause() override;
+    virtual void resume() override;
 
 signals:
     void deviceOpened();
@@ -57,6 +62,7 @@ private:
     void stream();
     void freelistCallback(int freelistIndex);
     int getFreelistSlotLockless();
+    bool isScreenFrameWanted(const AVPacket& packet);
     bool openDevice();
     void closeDevice();
 
@@ -72,8 +78,18 @@ private:
     std::atomic_bool _isOpen;
     std::atomic_bool streamBlocker;
     std::atomic_int subscriptions;
+    std::atomic_int pausedSubscriptions;
+    bool screenCapture;
+    bool screenChangePending;
+    ScreenChangeDetector screenDetector;
+    QElapsedTimer screenTimer;
+    qint64 lastScreenFrame;
 
     static CameraSource* instance;
+
+    static constexpr qint64 SCREEN_IDLE_INTERVAL = 1000;
+    static constexpr qint64 SCREEN_MINOR_INTERVAL = 250;
+    static constexpr int SCREEN_MINOR_PERCENT = 2;
 };
 
 #endif // CAMERA_H
@@ -24,6 +24,9 @@ extern "C" {
 
 #include "corevideosource.h"
 #include "videoframe.h"
+#include "src/allocstats.h"
+
+#include <QtConcurrent/QtConcurrentRun>
 
 /**
 @class CoreVideoSource
@@ -34,9 +37,25 @@ extern "C" {
 @var std::atomic_int subscribers
 @brief Number of suscribers
 
+@var std::atomic_int pausedSubscribers
+@brief Number of suscribers that don't need frames for now
+
 @var std::atomic_bool deleteOnClose
 @brief If true, self-delete after the last suscriber is gone
+
+@var QQueue<PendingFrame> CoreVideoSource::pendingFrames
+@brief Copied frames waiting to be emitted by processThread, guarded by queueLock.
+
+@var QThreadPool CoreVideoSource::processThread
+@brief Single thread that turns pending frames into VideoFrames and emits them.
+*/
+
+/**
+@brief Frames held for processThread before the oldest ones are dropped.
+
+A frame that waited behind two newer ones is stale, showing it would only add latency.
 */
+static const int maxPendingFrames = 2;
 
 /**
 @brief CoreVideoSource constructor.
@@ -44,69 +63,152 @@ extern "C" {
 only CoreAV can push images to it.
 */
 CoreVideoSource::CoreVideoSource()
-    : subscribers{0}, deleteOnClose{false},
+    : subscribers{0}, pausedSubscribers{0}, deleteOnClose{false},
     stopped{false}
 {
+    processThread.setMaxThreadCount(1);
+}
+
+CoreVideoSource::~CoreVideoSource()
+{
+    processThread.waitForDone();
+    dropPendingFrames();
 }
 
 /**
-@brief Makes a copy of the vpx_image_t and emits it as a new VideoFrame.
+@brief Makes a copy of the vpx_image_t and queues it to be emitted as a new VideoFrame.
 @param vpxframe Frame to copy.
+
+Runs on the toxav thread, so only the copy is done here, the planes aren't valid after we return.
+The VideoFrame is built and emitted by processThread, so that audio isn't delayed by video.
 */
 void CoreVideoSource::pushFrame(const vpx_image_t* vpxframe)
 {
+    ALLOC_SCOPE(Video);
+
     if (stopped)
         return;
 
-    QMutexLocker locker(&biglock);
+    // Don't bother copying frames nobody will look at
+    if (subscribers <= pausedSubscribers)
+        return;
 
-    std::shared_ptr<VideoFrame> vframe;
     int width = vpxframe->d_w;
     int height = vpxframe->d_h;
 
-    if (subscribers <= 0)
-        return;
-
-    AVFrame* avframe = av_frame_alloc();
-    if (!avframe)
-        return;
-    avframe->width = width;
-    avframe->height = height;
-    avframe->format = AV_PIX_FMT_YUV420P;
-
     int imgBufferSize = av_image_get_buffer_size(AV_PIX_FMT_YUV420P, width, height, 1);
     uint8_t* buf = (uint8_t*)av_malloc(imgBufferSize);
     if (!buf)
-    {
-        av_frame_free(&avframe);
         return;
-    }
-    avframe->opaque = buf;
 
-    uint8_t** data = avframe->data;
-    int* linesize = avframe->linesize;
+    AllocStats::allocated(AllocStats::Video, imgBufferSize);
+
+    uint8_t* data[4];
+    int linesize[4];
     av_image_fill_arrays(data, linesize, buf, AV_PIX_FMT_YUV420P, width, height, 1);
 
     for (int i = 0; i < 3; i++)
     {
-        int dstStride = avframe->linesize[i];
+        int dstStride = linesize[i];
         int srcStride = vpxframe->stride[i];
         int minStride = std::min(dstStride, srcStride);
         int size = (i == 0) ? height : height / 2;
 
         for (int j = 0; j < size; j++)
         {
-            uint8_t *dst = avframe->data[i] + dstStride * j;
+            uint8_t *dst = data[i] + dstStride * j;
             uint8_t *src = vpxframe->planes[i] + srcStride * j;
             memcpy(dst, src, minStride);
         }
     }
 
-    vframe = std::make_shared<VideoFrame>(avframe);
+    QMutexLocker locker(&queueLock);
+    while (pendingFrames.size() >= maxPendingFrames)
+        freePendingFrame(pendingFrames.dequeue());
+
+    bool wasIdle = pendingFrames.isEmpty();
+    pendingFrames.enqueue({buf, width, height});
+    if (wasIdle)
+        QtConcurrent::run(&processThread, [this]() { processFrames(); });
+}
+
+/**
+@brief Emits pending frames until the queue is empty.
+@note Runs on processThread.
+*/
+void CoreVideoSource::processFrames()
+{
+    forever
+    {
+        PendingFrame frame;
+        {
+            QMutexLocker locker(&queueLock);
+            if (pendingFrames.isEmpty())
+                return;
+
+            frame = pendingFrames.dequeue();
+        }
+
+        emitFrame(frame);
+    }
+}
+
+/**
+@brief Wraps a copied frame in a VideoFrame and emits it, taking ownership of its buffer.
+@param frame Frame copied by pushFrame.
+*/
+void CoreVideoSource::emitFrame(const PendingFrame& frame)
+{
+    ALLOC_SCOPE(Video);
+
+    QMutexLocker locker(&biglock);
+
+    if (stopped || subscribers <= pausedSubscribers)
+    {
+        freePendingFrame(frame);
+        return;
+    }
+
+    AVFrame* avframe = av_frame_alloc();
+    if (!avframe)
+    {
+        freePendingFrame(frame);
+        return;
+    }
+    avframe->width = frame.width;
+    avframe->height = frame.height;
+    avframe->format = AV_PIX_FMT_YUV420P;
+    avframe->opaque = frame.buffer;
+
+    av_image_fill_arrays(avframe->data, avframe->linesize, frame.buffer,
+                         AV_PIX_FMT_YUV420P, frame.width, frame.height, 1);
+
+    std::shared_ptr<VideoFrame> vframe = std::make_shared<VideoFrame>(avframe);
 
     emit frameAvailable(vframe);
 }
 
+/**
+@brief Frees the frames that processThread hasn't emitted yet.
+*/
+void CoreVideoSource::dropPendingFrames()
+{
+    QMutexLocker locker(&queueLock);
+    while (!pendingFrames.isEmpty())
+        freePendingFrame(pendingFrames.dequeue());
+}
+
+/**
+@brief Frees the buffer of a frame copied by pushFrame that won't be emitted.
+
+Emitted buffers are freed by their VideoFrame instead.
+*/
+void CoreVideoSource::freePendingFrame(const PendingFrame& frame)
+{
+    AllocStats::freed(AllocStats::Video, av_image_get_buffer_size(AV_PIX_FMT_YUV420P, frame.width, frame.height, 1));
+    av_free(frame.buffer);
+}
+
 bool CoreVideoSource::subscribe()
 {
     QMutexLocker locker(&biglock);
@@ -130,6 +232,16 @@ void CoreVideoSource::unsubscribe()
     biglock.unlock();
 }
 
+void CoreVideoSource::pause()
+{
+    ++pausedSubscribers;
+}
+
+void CoreVideoSource::resume()
+{
+    --pausedSubscribers;
+}
+
 /**
 @brief Setup delete on close
 @param If true, self-delete after the last suscriber is gone
@@ -144,12 +256,14 @@ void CoreVideoSource::setDeleteOnClose(bool newstate)
 @brief Stopping the source.
 @see The callers in CoreAV for the rationale
 
-Stopping the source will block any pushFrame calls from doing anything
+Stopping the source will block any pushFrame calls from doing anything,
+and drops the frames that were still waiting to be emitted.
 */
 void CoreVideoSource::stopSource()
 {
     QMutexLocker locker(&biglock);
     stopped = true;
+    dropPendingFrames();
     emit sourceStopped();
 }
 
@@ -25,19 +25,36 @@
 #include <atomic>
 #include "videosource.h"
 #include <QMutex>
+#include <QQueue>
+#include <QThreadPool>
 
 class CoreVideoSource : public VideoSource
 {
     Q_OBJECT
 public:
+    ~CoreVideoSource();
+
     // VideoSource interface
     virtual bool subscribe() override;
     virtual void unsubscribe() override;
+    virtual void pause() override;
+    virtual void resume() override;
 
 private:
+    struct PendingFrame
+    {
+        uint8_t* buffer;
+        int width;
+        int height;
+    };
+
     CoreVideoSource();
 
     void pushFrame(const vpx_image_t *frame);
+    void processFrames();
+    void emitFrame(const PendingFrame& frame);
+    void dropPendingFrames();
+    static void freePendingFrame(const PendingFrame& frame);
     void setDeleteOnClose(bool newstate);
 
     void stopSource();
@@ -45,9 +62,13 @@ private:
 
 private:
     std::atomic_int subscribers;
+    std::atomic_int pausedSubscribers;
     std::atomic_bool deleteOnClose;
     QMutex biglock;
     std::atomic_bool stopped;
+    QMutex queueLock;
+    QQueue<PendingFrame> pendingFrames;
+    QThreadPool processThread;
 
 friend class CoreAV;
 friend struct ToxFriendCall;
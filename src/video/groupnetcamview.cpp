@@ -20,6 +20,7 @@
 #include "groupnetcamview.h"
 #include "src/widget/tool/croppinglabel.h"
 #include "src/video/videosurface.h"
+#include "src/video/videogrid.h"
 #include "src/persistence/profile.h"
 #include "src/audio/audio.h"
 #include "src/core/core.h"
@@ -27,7 +28,6 @@
 #include "src/friendlist.h"
 #include "src/friend.h"
 #include <QBoxLayout>
-#include <QScrollArea>
 #include <QSplitter>
 #include <QTimer>
 #include <QMap>
@@ -125,20 +125,11 @@ GroupNetCamView::GroupNetCamView(int group, QWidget *parent)
     splitter->addWidget(videoLabelSurface);
     splitter->setStyleSheet("QSplitter { background-color: black; } QSplitter::handle { background-color: black; }");
 
-    QScrollArea* scrollArea = new QScrollArea();
-    scrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    scrollArea->setFrameStyle(QFrame::NoFrame);
-    QWidget* widget = new QWidget(nullptr);
-    scrollArea->setWidgetResizable(true);
-    horLayout = new QHBoxLayout(widget);
-    horLayout->addStretch(1);
-
-    selfVideoSurface = new LabeledVideo(Nexus::getProfile()->loadAvatar(), this);
-    horLayout->addWidget(selfVideoSurface);
-
-    horLayout->addStretch(1);
-    splitter->addWidget(scrollArea);
-    scrollArea->setWidget(widget);
+    // All peers, ourselves included as tile -1, are rendered by a single grid
+    videoGrid = new VideoGrid();
+    videoGrid->setMinimumHeight(64);
+    videoGrid->addTile(-1, Nexus::getProfile()->loadAvatar(), Core::getInstance()->getUsername());
+    splitter->addWidget(videoGrid);
 
     connect(&Audio::getInstance(), &Audio::groupAudioPlayed, this, &GroupNetCamView::groupAudioPlayed);
 
@@ -149,17 +140,15 @@ GroupNetCamView::GroupNetCamView(int group, QWidget *parent)
 
     connect(Core::getInstance(), &Core::selfAvatarChanged, [this](const QPixmap& pixmap)
     {
-        selfVideoSurface->getVideoSurface()->setAvatar(pixmap);
+        videoGrid->setAvatar(-1, pixmap);
         findActivePeer();
     });
     connect(Core::getInstance(), &Core::usernameSet, [this](const QString& username)
     {
-        selfVideoSurface->setText(username);
+        videoGrid->setName(-1, username);
         findActivePeer();
     });
     connect(Core::getInstance(), &Core::friendAvatarChanged, this, &GroupNetCamView::friendAvatarChanged);
-
-    selfVideoSurface->setText(Core::getInstance()->getUsername());
 }
 
 void GroupNetCamView::clearPeers()
@@ -173,12 +162,8 @@ void GroupNetCamView::clearPeers()
 void GroupNetCamView::addPeer(int peer, const QString& name)
 {
     QPixmap groupAvatar = Nexus::getProfile()->loadAvatar(Core::getInstance()->getGroupPeerToxId(group, peer).toString());
-    LabeledVideo* labeledVideo = new LabeledVideo(groupAvatar, this);
-    labeledVideo->setText(name);
-    horLayout->insertWidget(horLayout->count() - 1, labeledVideo);
-    PeerVideo peerVideo;
-    peerVideo.video = labeledVideo;
-    videoList.insert(peer, peerVideo);
+    videoGrid->addTile(peer, groupAvatar, name);
+    videoList.insert(peer, PeerVideo());
 
     findActivePeer();
 }
@@ -189,9 +174,7 @@ void GroupNetCamView::removePeer(int peer)
 
     if (peerVideo != videoList.end())
     {
-        LabeledVideo* labeledVideo = peerVideo.value().video;
-        horLayout->removeWidget(labeledVideo);
-        labeledVideo->deleteLater();
+        videoGrid->removeTile(peer);
         videoList.remove(peer);
 
         findActivePeer();
@@ -202,7 +185,8 @@ void GroupNetCamView::setActive(int peer)
 {
     if (peer == -1)
     {
-        videoLabelSurface->setText(selfVideoSurface->getText());
+        videoLabelSurface->setText(videoGrid->getName(-1));
+        videoGrid->setActive(-1);
         activePeer = -1;
         return;
     }
@@ -212,17 +196,11 @@ void GroupNetCamView::setActive(int peer)
     if (peerVideo != videoList.end())
     {
         // When group video exists:
-        // videoSurface->setSource(peerVideo.value()->getVideoSurface()->source);
+        // videoGrid->setSource(peer, source);
 
-        auto lastVideo = videoList.find(activePeer);
-
-        if (lastVideo != videoList.end())
-            lastVideo.value().video->setActive(false);
-
-        LabeledVideo *labeledVideo = peerVideo.value().video;
-        videoLabelSurface->setText(labeledVideo->getText());
-        videoLabelSurface->getVideoSurface()->setAvatar(labeledVideo->getVideoSurface()->getAvatar());
-        labeledVideo->setActive();
+        videoLabelSurface->setText(videoGrid->getName(peer));
+        videoLabelSurface->getVideoSurface()->setAvatar(videoGrid->getAvatar(peer));
+        videoGrid->setActive(peer);
 
         activePeer = peer;
     }
@@ -264,11 +242,9 @@ void GroupNetCamView::friendAvatarChanged(int FriendId, const QPixmap &pixmap)
     {
         if (Core::getInstance()->getGroupPeerToxId(group, i) == f->getToxId())
         {
-            auto peerVideo = videoList.find(i);
-
-            if (peerVideo != videoList.end())
+            if (videoGrid->hasTile(i))
             {
-                peerVideo.value().video->getVideoSurface()->setAvatar(pixmap);
+                videoGrid->setAvatar(i, pixmap);
                 findActivePeer();
             }
 
@@ -24,7 +24,7 @@
 #include <QMap>
 
 class LabeledVideo;
-class QHBoxLayout;
+class VideoGrid;
 
 class GroupNetCamView : public GenericNetCamView
 {
@@ -44,16 +44,14 @@ private slots:
 private:
     struct PeerVideo
     {
-        LabeledVideo* video;
         unsigned short volume = 0;
     };
 
     void setActive(int peer);
 
-    QHBoxLayout* horLayout;
+    VideoGrid* videoGrid;
     QMap<int, PeerVideo> videoList;
     LabeledVideo* videoLabelSurface;
-    LabeledVideo* selfVideoSurface;
     int activePeer;
     int group;
 };
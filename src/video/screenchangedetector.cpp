@@ -0,0 +1,112 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "screenchangedetector.h"
+
+#include <QVector>
+#include <cstring>
+
+/**
+@class ScreenChangeDetector
+@brief Finds the regions of a captured screen that changed since the last capture.
+
+The screen is compared with the previous capture in square tiles of 32
+pixels, so the cost is a memcmp of the screen, and the dirty region has the
+granularity of a tile. Screen sharing uses it to skip frames while the screen
+is static.
+
+@var QByteArray ScreenChangeDetector::previous
+@brief Copy of the previous capture's pixels.
+*/
+
+static const int tileSize = 32;
+
+ScreenChangeDetector::ScreenChangeDetector()
+    : previousStride{0}
+{
+}
+
+/**
+@brief Compares a capture with the previous one, and remembers it.
+@param data Pixels of the capture.
+@param stride Length of a line in bytes.
+@param size Size of the capture in pixels.
+@param bytesPerPixel Size of a pixel in bytes.
+@return Region that changed, all of it if the capture changed size.
+*/
+QRegion ScreenChangeDetector::update(const uint8_t* data, int stride, QSize size, int bytesPerPixel)
+{
+    const int length = stride * size.height();
+
+    if (size != previousSize || stride != previousStride || previous.size() != length)
+    {
+        previous = QByteArray(reinterpret_cast<const char*>(data), length);
+        previousSize = size;
+        previousStride = stride;
+        return QRegion(QRect(QPoint(), size));
+    }
+
+    uint8_t* old = reinterpret_cast<uint8_t*>(previous.data());
+    QVector<QRect> dirty;
+
+    for (int y = 0; y < size.height(); y += tileSize)
+    {
+        const int tileHeight = qMin(tileSize, size.height() - y);
+
+        for (int x = 0; x < size.width(); x += tileSize)
+        {
+            const int tileWidth = qMin(tileSize, size.width() - x);
+            const int offset = y * stride + x * bytesPerPixel;
+            const int lineLength = tileWidth * bytesPerPixel;
+
+            for (int line = 0; line < tileHeight; ++line)
+            {
+                const int pos = offset + line * stride;
+                if (memcmp(data + pos, old + pos, lineLength) != 0)
+                {
+                    // QRegion::setRects wants tiles touching horizontally to be merged
+                    if (!dirty.isEmpty() && dirty.last().top() == y && dirty.last().right() + 1 == x)
+                        dirty.last().setWidth(dirty.last().width() + tileWidth);
+                    else
+                        dirty.append(QRect(x, y, tileWidth, tileHeight));
+
+                    // Only the changed tile needs to be remembered
+                    for (int l = line; l < tileHeight; ++l)
+                        memcpy(old + offset + l * stride, data + offset + l * stride, lineLength);
+
+                    break;
+                }
+            }
+        }
+    }
+
+    QRegion region;
+    region.setRects(dirty.constData(), dirty.size());
+    return region;
+}
+
+/**
+@brief Forgets the previous capture, the next one is reported as entirely dirty.
+*/
+void ScreenChangeDetector::reset()
+{
+    previous.clear();
+    previousSize = QSize();
+    previousStride = 0;
+}
@@ -0,0 +1,41 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCREENCHANGEDETECTOR_H
+#define SCREENCHANGEDETECTOR_H
+
+#include <QByteArray>
+#include <QRegion>
+#include <QSize>
+
+class ScreenChangeDetector
+{
+public:
+    ScreenChangeDetector();
+
+    QRegion update(const uint8_t* data, int stride, QSize size, int bytesPerPixel);
+    void reset();
+
+private:
+    QByteArray previous;
+    int previousStride;
+    QSize previousSize;
+};
+
+#endif // SCREENCHANGEDETECTOR_H
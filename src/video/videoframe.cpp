@@ -29,6 +29,7 @@ extern "C" {
 }
 #include "videoframe.h"
 #include "camerasource.h"
+#include "src/allocstats.h"
 
 /**
 @class VideoFrame
@@ -39,6 +40,8 @@ All references to the frame data become invalid when the VideoFrame is deleted
 We try to avoid pixel format conversions as much as possible, at the cost of some memory
 All methods are thread-safe. If provided freelistCallback will be called by the destructor,
 unless releaseFrame was called in between.
+The buffers of the frame we're given are accounted to AllocStats by its source,
+we account our conversions and release both.
 */
 
 VideoFrame::VideoFrame(AVFrame* frame, int w, int h, int fmt, std::function<void()> freelistCallback)
@@ -108,6 +111,62 @@ QImage VideoFrame::toQImage(QSize size)
     return QImage(*frameRGB24->data, frameRGB24->width, frameRGB24->height, *frameRGB24->linesize, QImage::Format_RGB888);
 }
 
+/**
+@brief Scales and converts the VideoFrame straight into a region of an image.
+@param image Target image, must be in the QImage::Format_RGB888 format.
+@param region Region of the image to fill with the frame.
+@return True on success, false otherwise.
+
+Unlike toQImage, this writes directly into the target's pixels and doesn't
+keep a converted copy of the frame around.
+*/
+bool VideoFrame::scaleInto(QImage& image, QRect region)
+{
+    QMutexLocker locker(&biglock);
+
+    region &= image.rect();
+    if (image.format() != QImage::Format_RGB888 || region.isEmpty())
+        return false;
+
+    AVFrame* sourceFrame;
+    if (frameOther)
+    {
+        sourceFrame = frameOther;
+    }
+    else if (frameYUV420)
+    {
+        sourceFrame = frameYUV420;
+    }
+    else if (frameRGB24 && pixFmt == AV_PIX_FMT_RGB24)
+    {
+        sourceFrame = frameRGB24;
+    }
+    else
+    {
+        qWarning() << "None of the frames are valid! Did someone release us?";
+        return false;
+    }
+
+    uint8_t* data[4] = {image.bits() + region.y() * image.bytesPerLine() + region.x() * 3,
+                        nullptr, nullptr, nullptr};
+    int linesize[4] = {image.bytesPerLine(), 0, 0, 0};
+
+    // Bilinear is better for shrinking, bicubic better for upscaling
+    int resizeAlgo = region.width()<=width ? SWS_BILINEAR : SWS_BICUBIC;
+
+    SwsContext *swsCtx =  sws_getContext(width, height, (AVPixelFormat)pixFmt,
+                                          region.width(), region.height(), AV_PIX_FMT_RGB24,
+                                          resizeAlgo, nullptr, nullptr, nullptr);
+    if (!swsCtx)
+        return false;
+
+    sws_scale(swsCtx, (uint8_t const * const *)sourceFrame->data,
+                sourceFrame->linesize, 0, height, data, linesize);
+    sws_freeContext(swsCtx);
+
+    return true;
+}
+
 /**
 @brief Converts the VideoFrame to a vpx_image_t.
 Converts the VideoFrame to a vpx_image_t that shares our internal video buffer.
@@ -168,6 +227,7 @@ bool VideoFrame::convertToRGB24(QSize size)
         if (frameRGB24->width == size.width() && frameRGB24->height == size.height())
             return true;
 
+        AllocStats::freed(AllocStats::Video, bufferSize(frameRGB24));
         av_free(frameRGB24->opaque);
         av_frame_unref(frameRGB24);
         av_frame_free(&frameRGB24);
@@ -195,6 +255,8 @@ bool VideoFrame::convertToRGB24(QSize size)
     av_image_fill_arrays(data, linesize, buf, AV_PIX_FMT_RGB24, size.width(), size.height(), 1);
     frameRGB24->width = size.width();
     frameRGB24->height = size.height();
+    frameRGB24->format = AV_PIX_FMT_RGB24;
+    AllocStats::allocated(AllocStats::Video, imgBufferSize);
 
     // Bilinear is better for shrinking, bicubic better for upscaling
     int resizeAlgo = size.width()<=width ? SWS_BILINEAR : SWS_BICUBIC;
@@ -240,7 +302,7 @@ bool VideoFrame::convertToYUV420()
         return false;
     }
 
-    int imgBufferSize = av_image_get_buffer_size(AV_PIX_FMT_RGB24, width, height, 1);
+    int imgBufferSize = av_image_get_buffer_size(AV_PIX_FMT_YUV420P, width, height, 1);
     uint8_t* buf = (uint8_t*)av_malloc(imgBufferSize);
     if (!buf)
     {
@@ -253,6 +315,10 @@ bool VideoFrame::convertToYUV420()
     uint8_t** data = frameYUV420->data;
     int* linesize = frameYUV420->linesize;
     av_image_fill_arrays(data, linesize, buf, AV_PIX_FMT_YUV420P, width, height, 1);
+    frameYUV420->width = width;
+    frameYUV420->height = height;
+    frameYUV420->format = AV_PIX_FMT_YUV420P;
+    AllocStats::allocated(AllocStats::Video, imgBufferSize);
 
     SwsContext *swsCtx =  sws_getContext(width, height, (AVPixelFormat)pixFmt,
                                           width, height, AV_PIX_FMT_YUV420P,
@@ -282,18 +348,21 @@ void VideoFrame::releaseFrameLockless()
 {
     if (frameOther)
     {
+        AllocStats::freed(AllocStats::Video, bufferSize(frameOther));
         av_free(frameOther->opaque);
         av_frame_unref(frameOther);
         av_frame_free(&frameOther);
     }
     if (frameYUV420)
     {
+        AllocStats::freed(AllocStats::Video, bufferSize(frameYUV420));
         av_free(frameYUV420->opaque);
         av_frame_unref(frameYUV420);
         av_frame_free(&frameYUV420);
     }
     if (frameRGB24)
     {
+        AllocStats::freed(AllocStats::Video, bufferSize(frameRGB24));
         av_free(frameRGB24->opaque);
         av_frame_unref(frameRGB24);
         av_frame_free(&frameRGB24);
@@ -308,3 +377,13 @@ QSize VideoFrame::getSize()
 {
     return {width, height};
 }
+
+/**
+@brief Computes the size of a frame's picture buffer, as accounted to AllocStats.
+@param frame Frame with its width, height and format set.
+@return Size in bytes, negative on error.
+*/
+int VideoFrame::bufferSize(const AVFrame* frame)
+{
+    return av_image_get_buffer_size(static_cast<AVPixelFormat>(frame->format), frame->width, frame->height, 1);
+}
@@ -41,8 +41,11 @@ public:
     void releaseFrame();
 
     QImage toQImage(QSize size = QSize());
+    bool scaleInto(QImage& image, QRect region);
     vpx_image* toVpxImage();
 
+    static int bufferSize(const AVFrame* frame);
+
 protected:
     bool convertToRGB24(QSize size = QSize());
     bool convertToYUV420();
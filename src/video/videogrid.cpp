@@ -0,0 +1,355 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "videogrid.h"
+#include "src/video/videoframe.h"
+#include "src/video/videosource.h"
+#include "src/widget/style.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+
+/**
+@class VideoGrid
+@brief Renders the video or avatar tiles of several peers as a single widget.
+
+All tiles are laid out in a grid and composited into one back buffer.
+Video frames are scaled and converted straight into their tile's region of
+that buffer, and only the tiles that changed are rendered and repainted.
+
+Tiles are identified by an integer chosen by the caller, usually a peer number.
+
+@var QImage VideoGrid::backBuffer
+@brief Composited image of all the tiles, in the QImage::Format_RGB888 format.
+
+@var static constexpr int VideoGrid::noTile
+@brief Id no tile can have, setActive() takes it to highlight none.
+
+@var int VideoGrid::activeTile
+@brief Tile drawn highlighted, or noTile.
+
+@var bool VideoGrid::paused
+@brief True when the sources of the tiles are paused because we are hidden.
+*/
+
+static const int tileMargin = 6;
+
+VideoGrid::VideoGrid(QWidget* parent)
+    : QWidget(parent)
+    , activeTile{noTile}
+    , paused{false}
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+VideoGrid::~VideoGrid()
+{
+    for (int id : tiles.keys())
+        setSource(id, nullptr);
+}
+
+void VideoGrid::addTile(int id, const QPixmap& avatar, const QString& name)
+{
+    if (tiles.contains(id))
+        removeTile(id);
+
+    Tile tile;
+    tile.avatar = avatar;
+    tile.name = name;
+    tiles.insert(id, tile);
+
+    relayout();
+}
+
+void VideoGrid::removeTile(int id)
+{
+    if (!tiles.contains(id))
+        return;
+
+    setSource(id, nullptr);
+    tiles.remove(id);
+
+    relayout();
+}
+
+bool VideoGrid::hasTile(int id) const
+{
+    return tiles.contains(id);
+}
+
+QList<int> VideoGrid::getTiles() const
+{
+    return tiles.keys();
+}
+
+void VideoGrid::setAvatar(int id, const QPixmap& avatar)
+{
+    auto it = tiles.find(id);
+    if (it == tiles.end())
+        return;
+
+    it->avatar = avatar;
+    invalidate(id);
+}
+
+QPixmap VideoGrid::getAvatar(int id) const
+{
+    return tiles.value(id).avatar;
+}
+
+void VideoGrid::setName(int id, const QString& name)
+{
+    auto it = tiles.find(id);
+    if (it == tiles.end())
+        return;
+
+    it->name = name;
+    invalidate(id);
+}
+
+QString VideoGrid::getName(int id) const
+{
+    return tiles.value(id).name;
+}
+
+/**
+@brief Shows the video of a source in a tile.
+@note nullptr is a valid option, the tile shows its avatar then.
+@param id Tile to update.
+@param source Source to show.
+*/
+void VideoGrid::setSource(int id, VideoSource* source)
+{
+    auto it = tiles.find(id);
+    if (it == tiles.end() || it->source == source)
+        return;
+
+    if (it->source)
+    {
+        disconnect(it->connection);
+        if (paused)
+            it->source->resume();
+
+        it->source->unsubscribe();
+    }
+
+    it->source = source;
+    it->lastFrame.reset();
+
+    if (source)
+    {
+        source->subscribe();
+        if (paused)
+            source->pause();
+
+        it->connection = connect(source, &VideoSource::frameAvailable, this,
+                                 [this, id](std::shared_ptr<VideoFrame> frame)
+        {
+            onFrameAvailable(id, frame);
+        });
+    }
+
+    invalidate(id);
+}
+
+/**
+@brief Highlights a tile, and only this one.
+@param id Tile to highlight, noTile to highlight none.
+*/
+void VideoGrid::setActive(int id)
+{
+    if (id == activeTile)
+        return;
+
+    int lastTile = activeTile;
+    activeTile = id;
+
+    invalidate(lastTile);
+    invalidate(activeTile);
+}
+
+void VideoGrid::paintEvent(QPaintEvent* event)
+{
+    for (auto it = tiles.begin(); it != tiles.end(); ++it)
+    {
+        if (it->dirty && it->rect.intersects(event->rect()))
+        {
+            renderTile(it.key(), *it);
+            it->dirty = false;
+        }
+    }
+
+    QPainter painter(this);
+    painter.drawImage(event->rect(), backBuffer, event->rect());
+}
+
+void VideoGrid::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    relayout();
+}
+
+void VideoGrid::showEvent(QShowEvent* event)
+{
+    Q_UNUSED(event);
+
+    if (!paused)
+        return;
+
+    paused = false;
+    for (const Tile& tile : tiles)
+    {
+        if (tile.source)
+            tile.source->resume();
+    }
+}
+
+void VideoGrid::hideEvent(QHideEvent* event)
+{
+    Q_UNUSED(event);
+
+    if (paused)
+        return;
+
+    paused = true;
+    for (const Tile& tile : tiles)
+    {
+        if (tile.source)
+            tile.source->pause();
+    }
+}
+
+void VideoGrid::onFrameAvailable(int id, std::shared_ptr<VideoFrame> frame)
+{
+    auto it = tiles.find(id);
+    if (it == tiles.end())
+        return;
+
+    it->lastFrame = frame;
+    invalidate(id);
+}
+
+/**
+@brief Marks a tile for rendering and schedules a repaint of its region only.
+*/
+void VideoGrid::invalidate(int id)
+{
+    auto it = tiles.find(id);
+    if (it == tiles.end())
+        return;
+
+    it->dirty = true;
+    update(it->rect);
+}
+
+/**
+@brief Lays out the tiles in the grid that makes them the largest, and renders them again.
+*/
+void VideoGrid::relayout()
+{
+    backBuffer = QImage(size(), QImage::Format_RGB888);
+    backBuffer.fill(Qt::black);
+
+    int count = tiles.size();
+    if (count == 0 || size().isEmpty())
+    {
+        update();
+        return;
+    }
+
+    // Tiles are sized for a 4:3 content, pick the column count where it's the widest
+    int bestColumns = 1;
+    int bestWidth = 0;
+    for (int columns = 1; columns <= count; ++columns)
+    {
+        int rows = (count + columns - 1) / columns;
+        int tileWidth = qMin(width() / columns, height() / rows * 4 / 3);
+        if (tileWidth > bestWidth)
+        {
+            bestWidth = tileWidth;
+            bestColumns = columns;
+        }
+    }
+
+    int rows = (count + bestColumns - 1) / bestColumns;
+    QSize tileSize(width() / bestColumns, height() / rows);
+
+    int i = 0;
+    for (Tile& tile : tiles)
+    {
+        QPoint pos((i % bestColumns) * tileSize.width(), (i / bestColumns) * tileSize.height());
+        tile.rect = QRect(pos, tileSize);
+        tile.dirty = true;
+        ++i;
+    }
+
+    update();
+}
+
+/**
+@brief Renders a tile into its region of the back buffer.
+*/
+void VideoGrid::renderTile(int id, Tile& tile)
+{
+    int labelHeight = fontMetrics().height();
+    QRect content = tile.rect.adjusted(tileMargin, tileMargin, -tileMargin, -tileMargin - labelHeight);
+    QRect labelRect(content.left(), content.bottom() + 1, content.width(), labelHeight);
+
+    // Video and avatar keep their aspect ratio, centered in the tile
+    QSize sourceSize;
+    if (tile.lastFrame)
+        sourceSize = tile.lastFrame->getSize();
+    else if (!tile.avatar.isNull())
+        sourceSize = tile.avatar.size();
+    else
+        sourceSize = QSize(1, 1);
+
+    QRect target(QPoint(), sourceSize.scaled(content.size(), Qt::KeepAspectRatio));
+    target.moveCenter(content.center());
+
+    {
+        QPainter painter(&backBuffer);
+        painter.fillRect(tile.rect, Qt::black);
+
+        if (id == activeTile)
+        {
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.setPen(Qt::NoPen);
+            painter.setBrush(Style::getColor(Style::MediumGrey));
+            painter.drawRoundedRect(tile.rect.adjusted(1, 1, -1, -1), 10, 10);
+        }
+
+        if (!tile.lastFrame)
+        {
+            QPixmap avatar = tile.avatar;
+            if (avatar.isNull())
+                avatar = Style::scaleSvgImage(":/img/contact_dark.svg", target.width(), target.height());
+
+            painter.fillRect(target, Qt::white);
+            painter.drawPixmap(target, avatar, avatar.rect());
+        }
+
+        painter.setPen(Qt::white);
+        QString name = fontMetrics().elidedText(tile.name, Qt::ElideRight, labelRect.width());
+        painter.drawText(labelRect, Qt::AlignCenter, name);
+    }
+
+    if (tile.lastFrame && !tile.lastFrame->scaleInto(backBuffer, target))
+        tile.lastFrame.reset();
+}
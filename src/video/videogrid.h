@@ -0,0 +1,84 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VIDEOGRID_H
+#define VIDEOGRID_H
+
+#include <QWidget>
+#include <QMap>
+#include <QImage>
+#include <limits>
+#include <memory>
+
+class VideoFrame;
+class VideoSource;
+
+class VideoGrid : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr int noTile = std::numeric_limits<int>::min();
+
+    explicit VideoGrid(QWidget* parent = nullptr);
+    ~VideoGrid();
+
+    void addTile(int id, const QPixmap& avatar, const QString& name);
+    void removeTile(int id);
+    bool hasTile(int id) const;
+    QList<int> getTiles() const;
+
+    void setAvatar(int id, const QPixmap& avatar);
+    QPixmap getAvatar(int id) const;
+    void setName(int id, const QString& name);
+    QString getName(int id) const;
+    void setSource(int id, VideoSource* source);
+    void setActive(int id);
+
+protected:
+    virtual void paintEvent(QPaintEvent* event) final override;
+    virtual void resizeEvent(QResizeEvent* event) final override;
+    virtual void showEvent(QShowEvent* event) final override;
+    virtual void hideEvent(QHideEvent* event) final override;
+
+private:
+    struct Tile
+    {
+        QPixmap avatar;
+        QString name;
+        VideoSource* source = nullptr;
+        std::shared_ptr<VideoFrame> lastFrame;
+        QMetaObject::Connection connection;
+        QRect rect;
+        bool dirty = true;
+    };
+
+    void onFrameAvailable(int id, std::shared_ptr<VideoFrame> frame);
+    void invalidate(int id);
+    void relayout();
+    void renderTile(int id, Tile& tile);
+
+private:
+    QMap<int, Tile> tiles;
+    QImage backBuffer;
+    int activeTile;
+    bool paused;
+};
+
+#endif // VIDEOGRID_H
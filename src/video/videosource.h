@@ -45,6 +45,16 @@ public:
     Stop emitting frameAvailable signals, and free associated resources if necessary.
     */
     virtual void unsubscribe() = 0;
+    /**
+    Tell the source that one of its subscribers doesn't need frames for now.
+    The subscription stays open, so resuming is instant, but while every
+    subscription is paused the source may stop producing frames.
+    */
+    virtual void pause() = 0;
+    /**
+    Undo a previous pause() of the same subscriber.
+    */
+    virtual void resume() = 0;
 
 signals:
     /**
@@ -33,6 +33,12 @@
 /**
 @var std::atomic_bool VideoSurface::frameLock
 @brief Fast lock for lastFrame.
+
+@var bool VideoSurface::paused
+@brief True when our subscription is paused because the surface can't be seen.
+
+@var QPointer<QWidget> VideoSurface::observedWindow
+@brief Top-level window watched for minimization.
 */
 
 float getSizeRatio(const QSize size)
@@ -45,6 +51,7 @@ VideoSurface::VideoSurface(const QPixmap& avatar, QWidget* parent, bool expandin
     , source{nullptr}
     , frameLock{false}
     , hasSubscribed{0}
+    , paused{false}
     , avatar{avatar}
     , ratio{1.0f}
     , expanding{expanding}
@@ -115,6 +122,7 @@ void VideoSurface::subscribe()
         source->subscribe();
         connect(source, &VideoSource::frameAvailable, this, &VideoSurface::onNewFrameAvailable);
         connect(source, &VideoSource::sourceStopped, this, &VideoSurface::onSourceStopped);
+        updateExposure();
     }
 }
 
@@ -135,6 +143,12 @@ void VideoSurface::unsubscribe()
     emit ratioChanged();
     emit boundaryChanged();
 
+    if (paused)
+    {
+        paused = false;
+        source->resume();
+    }
+
     source->unsubscribe();
     disconnect(source, &VideoSource::frameAvailable, this, &VideoSurface::onNewFrameAvailable);
     disconnect(source, &VideoSource::sourceStopped, this, &VideoSurface::onSourceStopped);
@@ -188,7 +202,8 @@ void VideoSurface::paintEvent(QPaintEvent*)
         QPixmap drawnAvatar = avatar;
 
         if (drawnAvatar.isNull())
-            drawnAvatar = Style::scaleSvgImage(":/img/contact_dark.svg", boundingRect.width(), boundingRect.height());
+            drawnAvatar = Style::scaleSvgImage(":/img/contact_dark.svg", boundingRect.width(),
+                                               boundingRect.height(), devicePixelRatio());
 
         painter.drawPixmap(boundingRect, drawnAvatar, drawnAvatar.rect());
     }
@@ -201,12 +216,61 @@ void VideoSurface::resizeEvent(QResizeEvent* event)
     QWidget::resizeEvent(event);
     recalulateBounds();
     emit boundaryChanged();
+    updateExposure();
 }
 
 void VideoSurface::showEvent(QShowEvent* e)
 {
     Q_UNUSED(e);
     //emit ratioChanged();
+
+    // We may have been moved to another window since the last time we were shown
+    if (observedWindow != window())
+    {
+        if (observedWindow)
+            observedWindow->removeEventFilter(this);
+
+        observedWindow = window();
+        observedWindow->installEventFilter(this);
+    }
+
+    updateExposure();
+}
+
+void VideoSurface::hideEvent(QHideEvent* e)
+{
+    Q_UNUSED(e);
+    updateExposure();
+}
+
+bool VideoSurface::eventFilter(QObject* object, QEvent* event)
+{
+    if (object == observedWindow && event->type() == QEvent::WindowStateChange)
+        updateExposure();
+
+    return QWidget::eventFilter(object, event);
+}
+
+/**
+@brief Pauses our subscription while the surface can't be seen, resumes it otherwise.
+
+A hidden or collapsed surface, or one in a minimized window, doesn't need frames.
+Pausing lets the source stop decoding, while keeping it open to resume instantly.
+*/
+void VideoSurface::updateExposure()
+{
+    if (!source || hasSubscribed == 0)
+        return;
+
+    bool exposed = isVisible() && !size().isEmpty() && !window()->isMinimized();
+    if (exposed != paused)
+        return;
+
+    paused = !exposed;
+    if (paused)
+        source->pause();
+    else
+        source->resume();
 }
 
 void VideoSurface::recalulateBounds()
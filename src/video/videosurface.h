@@ -21,6 +21,7 @@
 #define SELFCAMVIEW_H
 
 #include <QWidget>
+#include <QPointer>
 #include <memory>
 #include <atomic>
 #include "src/video/videosource.h"
@@ -52,6 +53,8 @@ protected:
     virtual void paintEvent(QPaintEvent* event) final override;
     virtual void resizeEvent(QResizeEvent* event) final override;
     virtual void showEvent(QShowEvent* event) final override;
+    virtual void hideEvent(QHideEvent* event) final override;
+    virtual bool eventFilter(QObject* object, QEvent* event) final override;
 
 private slots:
     void onNewFrameAvailable(std::shared_ptr<VideoFrame> newFrame);
@@ -59,6 +62,7 @@ private slots:
 
 private:
     void recalulateBounds();
+    void updateExposure();
     void lock();
     void unlock();
 
@@ -67,6 +71,8 @@ private:
     std::shared_ptr<VideoFrame> lastFrame;
     std::atomic_bool frameLock;
     uint8_t hasSubscribed;
+    bool paused;
+    QPointer<QWidget> observedWindow;
     QPixmap avatar;
     float ratio;
     bool expanding;
@@ -20,6 +20,7 @@
 #include "contentlayout.h"
 #include "src/persistence/settings.h"
 #include "style.h"
+#include "src/widget/form/genericchatform.h"
 #include <QStyleFactory>
 #include <QFrame>
 
@@ -114,9 +115,14 @@ void ContentLayout::init()
         mainContent->setStyle(QStyleFactory::create(Settings::getInstance().getStyle()));
     }
 
+    // chat forms are styled by their container, see GenericChatForm::getStylesheet
+    QString chatFormStyle = GenericChatForm::getStylesheet();
 #ifndef Q_OS_MAC
-    mainHead->setStyleSheet(Style::getStylesheet(":ui/settings/mainHead.css"));
-    mainContent->setStyleSheet(Style::getStylesheet(":ui/settings/mainContent.css"));
+    mainHead->setStyleSheet(Style::getStylesheet(":ui/settings/mainHead.css") + chatFormStyle);
+    mainContent->setStyleSheet(Style::getStylesheet(":ui/settings/mainContent.css") + chatFormStyle);
+#else
+    mainHead->setStyleSheet(chatFormStyle);
+    mainContent->setStyleSheet(chatFormStyle);
 #endif
 
     mainHLineLayout.addWidget(&mainHLine);
@@ -34,6 +34,8 @@
 #include <QStyle>
 #include <QSplitter>
 #include <QClipboard>
+#include <QProgressDialog>
+#include <QtConcurrent/QtConcurrentRun>
 #include <cassert>
 #include "chatform.h"
 #include "src/audio/audio.h"
@@ -57,6 +59,7 @@
 #include "src/chatlog/chatlog.h"
 #include "src/video/netcamview.h"
 #include "src/persistence/offlinemsgengine.h"
+#include "src/widget/form/searchform.h"
 #include "src/widget/tool/screenshotgrabber.h"
 #include "src/widget/tool/flyoutoverlaywidget.h"
 #include "src/widget/translator.h"
@@ -65,8 +68,14 @@
 #include "src/nexus.h"
 #include "src/persistence/profile.h"
 
+// Messages fetched from the history per page by the "Load chat history" dialog
+static const int historyPageSize = 100;
+
 ChatForm::ChatForm(Friend* chatFriend)
     : f(chatFriend)
+    , historyProgress(nullptr)
+    , historyLoadBeforeId(0)
+    , historySearchJump(false)
     , isTyping(false)
 {
     Core* core = Core::getInstance();
@@ -105,6 +114,14 @@ ChatForm::ChatForm(Friend* chatFriend)
     loadHistoryAction = menu.addAction(QString(), this, SLOT(onLoadHistory()));
     copyStatusAction = statusMessageMenu.addAction(QString(), this, SLOT(onCopyStatusMessage()));
 
+    historyPageWatcher = new QFutureWatcher<QList<History::HistMessage>>(this);
+    connect(historyPageWatcher, &QFutureWatcher<QList<History::HistMessage>>::finished,
+            this, &ChatForm::onHistoryPageLoaded);
+
+    historySearchWatcher = new QFutureWatcher<QDateTime>(this);
+    connect(historySearchWatcher, &QFutureWatcher<QDateTime>::finished,
+            this, &ChatForm::onHistorySearchFinished);
+
     connect(core, &Core::fileSendStarted, this, &ChatForm::startFileSend);
     connect(sendButton, &QPushButton::clicked, this, &ChatForm::onSendTriggered);
     connect(fileButton, &QPushButton::clicked, this, &ChatForm::onAttachClicked);
@@ -116,6 +133,12 @@ ChatForm::ChatForm(Friend* chatFriend)
     connect(core, &Core::fileSendFailed, this, &ChatForm::onFileSendFailed);
     connect(core, &Core::friendStatusChanged, this, &ChatForm::onFriendStatusChanged);
     connect(this, &ChatForm::chatAreaCleared, getOfflineMsgEngine(), &OfflineMsgEngine::removeAllReceipts);
+    connect(this, &ChatForm::chatAreaCleared, this, [=]()
+    {
+        // the lines the pending date belonged to are gone
+        historyPendingDate = QDate();
+        stopHistoryLoad();
+    } );
     connect(statusMessageLabel, &CroppingLabel::customContextMenuRequested, this, [&](const QPoint& pos)
     {
         if (!statusMessageLabel->text().isEmpty())
@@ -144,6 +167,10 @@ ChatForm::ChatForm(Friend* chatFriend)
 ChatForm::~ChatForm()
 {
     Translator::unregister(this);
+
+    // the queries use the profile's history, which may be deleted right after us
+    historyPageWatcher->waitForFinished();
+    historySearchWatcher->waitForFinished();
     delete netcam;
     delete callConfirm;
     delete offlineEngine;
@@ -709,8 +736,53 @@ void ChatForm::onAvatarRemoved(uint32_t FriendId)
     avatar->setPixmap(QPixmap(":/img/contact_dark.svg"));
 }
 
+/**
+@brief Creates the chat line of a history message.
+@param it Message to show.
+@param prevId Author of the message shown above, updated to this message's author.
+@param prevDateTime Time of the message shown above, updated to this message's time.
+@param processUndelivered True to queue the message again if it was never delivered.
+@return The chat line.
+*/
+ChatMessage::Ptr ChatForm::createHistoryMessage(const History::HistMessage& it, ToxId& prevId,
+                                                QDateTime& prevDateTime, bool processUndelivered)
+{
+    QDateTime msgDateTime = it.timestamp.toLocalTime();
+    ToxId authorId = ToxId(it.sender);
+    QString authorStr = !it.dispName.isEmpty() ? it.dispName : (authorId.isSelf() ? Core::getInstance()->getUsername() : resolveToxId(authorId));
+    bool isAction = it.message.startsWith("/me ", Qt::CaseInsensitive);
+    bool needSending = !it.isSent && authorId.isSelf();
+
+    ChatMessage::Ptr msg = ChatMessage::createChatMessage(authorStr,
+                                                          isAction ? it.message.mid(4) : it.message,
+                                                          isAction ? ChatMessage::ACTION : ChatMessage::NORMAL,
+                                                          authorId.isSelf(),
+                                                          needSending ? QDateTime() : msgDateTime);
+
+    if (!isAction && (prevId == authorId) && (prevDateTime.secsTo(msgDateTime) < getChatLog()->repNameAfter) )
+        msg->hideSender();
+
+    prevId = authorId;
+    prevDateTime = msgDateTime;
+
+    if (needSending && processUndelivered)
+    {
+        auto* offMsgEngine = getOfflineMsgEngine();
+        qint64 id = it.id;
+        Core::getInstance()->queueMessage(f->getFriendID(), msg->toString(), isAction,
+                                          [offMsgEngine, id, msg](int rec)
+        {
+            offMsgEngine->registerReceipt(rec, id, msg);
+        });
+    }
+
+    return msg;
+}
+
 void ChatForm::loadHistory(QDateTime since, bool processUndelivered)
 {
+    stopHistoryLoad();
+
     QDateTime now = historyBaselineDate.addMSecs(-1);
 
     if (since > now)
@@ -749,37 +821,7 @@ void ChatForm::loadHistory(QDateTime since, bool processUndelivered)
         }
 
         // Show each messages
-        ToxId authorId = ToxId(it.sender);
-        QString authorStr = !it.dispName.isEmpty() ? it.dispName : (authorId.isSelf() ? Core::getInstance()->getUsername() : resolveToxId(authorId));
-        bool isAction = it.message.startsWith("/me ", Qt::CaseInsensitive);
-        bool needSending = !it.isSent && authorId.isSelf();
-
-        ChatMessage::Ptr msg = ChatMessage::createChatMessage(authorStr,
-                                                              isAction ? it.message.mid(4) : it.message,
-                                                              isAction ? ChatMessage::ACTION : ChatMessage::NORMAL,
-                                                              authorId.isSelf(),
-                                                              needSending ? QDateTime() : msgDateTime);
-
-        if (!isAction && (prevId == authorId) && (prevMsgDateTime.secsTo(msgDateTime) < getChatLog()->repNameAfter) )
-            msg->hideSender();
-
-        prevId = authorId;
-        prevMsgDateTime = msgDateTime;
-
-        if (needSending)
-        {
-            if (processUndelivered)
-            {
-                int rec;
-                if (!isAction)
-                    rec = Core::getInstance()->sendMessage(f->getFriendID(), msg->toString());
-                else
-                    rec = Core::getInstance()->sendAction(f->getFriendID(), msg->toString());
-
-                getOfflineMsgEngine()->registerReceipt(rec, it.id, msg);
-            }
-        }
-        historyMessages.append(msg);
+        historyMessages.append(createHistoryMessage(it, prevId, prevMsgDateTime, processUndelivered));
     }
 
     previousId = storedPrevId;
@@ -793,6 +835,203 @@ void ChatForm::loadHistory(QDateTime since, bool processUndelivered)
     chatWidget->verticalScrollBar()->setValue(savedSliderPos);
 }
 
+/**
+@brief Loads the history since a date in pages, newest messages first.
+@param since Date of the oldest message to load.
+
+Pages are fetched on a worker thread and prepended one by one, so the newest
+messages show up right away and the UI stays responsive. The load can be
+canceled from the progress dialog, keeping what was already loaded.
+*/
+void ChatForm::loadHistoryPaged(QDateTime since)
+{
+    stopHistoryLoad();
+
+    QDateTime before = earliestMessage.isNull() ? historyBaselineDate : earliestMessage;
+    if (since >= before)
+        return;
+
+    historyLoadSince = since;
+    historyLoadStart = before;
+    historyLoadBefore = before;
+    historyLoadBeforeId = 0;
+    historyPendingDate = QDate();
+
+    historyProgress = new QProgressDialog(tr("Loading chat history..."), tr("Cancel"), 0, 100, this);
+    historyProgress->setAutoReset(false);
+    historyProgress->setAutoClose(false);
+    historyProgress->setMinimumDuration(500);
+    connect(historyProgress, &QProgressDialog::canceled, this, &ChatForm::stopHistoryLoad);
+
+    requestHistoryPage();
+}
+
+/**
+@brief Fetches the next page of a paged history load on a worker thread.
+*/
+void ChatForm::requestHistoryPage()
+{
+    History* history = Nexus::getProfile()->getHistory();
+    QString friendPk = f->getToxId().publicKey;
+    QDateTime since = historyLoadSince;
+    QDateTime before = historyLoadBefore;
+    qint64 beforeId = historyLoadBeforeId;
+
+    historyPageWatcher->setFuture(QtConcurrent::run([=]()
+    {
+        return history->getChatHistoryPage(friendPk, since, before, beforeId, historyPageSize);
+    }));
+}
+
+/**
+@brief Prepends a fetched page of history and asks for the next one.
+
+The date of the oldest day of a page is only shown once the next page
+tells whether that day continues above.
+*/
+void ChatForm::onHistoryPageLoaded()
+{
+    if (!historyProgress)
+        return;
+
+    QList<History::HistMessage> msgs = historyPageWatcher->result();
+
+    ToxId storedPrevId = previousId;
+    ToxId prevId;
+    QDateTime prevDateTime;
+
+    QList<ChatLine::Ptr> historyMessages;
+    QDate firstDate;
+    QDate lastDate;
+    for (auto it = msgs.crbegin(); it != msgs.crend(); ++it)
+    {
+        QDate msgDate = it->timestamp.toLocalTime().date();
+        if (!lastDate.isValid())
+            firstDate = msgDate;
+        else if (msgDate != lastDate)
+            historyMessages.append(ChatMessage::createChatInfoMessage(msgDate.toString(Settings::getInstance().getDateFormat()), ChatMessage::INFO, QDateTime()));
+
+        lastDate = msgDate;
+        historyMessages.append(createHistoryMessage(*it, prevId, prevDateTime, false));
+    }
+
+    previousId = storedPrevId;
+
+    if (!msgs.isEmpty())
+    {
+        if (historyPendingDate.isValid() && historyPendingDate != lastDate)
+            historyMessages.append(ChatMessage::createChatInfoMessage(historyPendingDate.toString(Settings::getInstance().getDateFormat()), ChatMessage::INFO, QDateTime()));
+
+        historyPendingDate = firstDate;
+        historyLoadBefore = msgs.last().timestamp;
+        historyLoadBeforeId = msgs.last().id;
+        earliestMessage = historyLoadBefore;
+
+        chatWidget->insertChatlineOnTop(historyMessages);
+    }
+
+    if (msgs.size() < historyPageSize)
+    {
+        earliestMessage = historyLoadSince;
+        bool jump = historySearchJump;
+        historySearchJump = false;
+        stopHistoryLoad();
+
+        // the search runs again over the loaded lines, then jumps to the match
+        if (jump)
+            historySearchFinished(historySearchPhrase == searchForm->getSearchPhrase()
+                                  && searchForm->isVisible() && chatWidget->findPrevious());
+
+        return;
+    }
+
+    qint64 total = historyLoadSince.msecsTo(historyLoadStart);
+    qint64 done = historyLoadBefore.msecsTo(historyLoadStart);
+    historyProgress->setValue(total > 0 ? static_cast<int>(done * 100 / total) : 0);
+
+    requestHistoryPage();
+}
+
+/**
+@brief Ends a paged history load, keeping the pages already shown.
+
+Canceling the load of a history search match ends that search without a match.
+*/
+void ChatForm::stopHistoryLoad()
+{
+    if (!historyProgress)
+        return;
+
+    if (historySearchJump)
+    {
+        historySearchJump = false;
+        historySearchFinished(false);
+    }
+
+    if (historyPendingDate.isValid())
+    {
+        chatWidget->insertChatlineOnTop(ChatMessage::createChatInfoMessage(historyPendingDate.toString(Settings::getInstance().getDateFormat()), ChatMessage::INFO, QDateTime()));
+        historyPendingDate = QDate();
+    }
+
+    historyProgress->deleteLater();
+    historyProgress = nullptr;
+}
+
+/**
+@brief Looks for the latest unloaded message matching a phrase, on a worker thread.
+@param phrase Phrase to find.
+
+The history isn't indexed for this, so the query can take a while on large profiles.
+Requests made while a search or the load of its match is running are ignored,
+its result jumps to the match.
+*/
+void ChatForm::searchHistory(const QString& phrase)
+{
+    if (phrase.isEmpty() || !Nexus::getProfile()->isHistoryEnabled())
+    {
+        historySearchFinished(false);
+        return;
+    }
+
+    if (historySearchWatcher->isRunning() || historySearchJump)
+        return;
+
+    QDateTime before = earliestMessage.isNull() ? historyBaselineDate : earliestMessage;
+    History* history = Nexus::getProfile()->getHistory();
+    QString friendPk = f->getToxId().publicKey;
+    historySearchPhrase = phrase;
+    historySearchWatcher->setFuture(QtConcurrent::run([=]()
+    {
+        return history->getDateWhereFindPhrase(friendPk, before, phrase);
+    }));
+}
+
+/**
+@brief Loads the day of the message found by searchHistory().
+
+The day is loaded in pages like the "Load chat history" dialog does, the search
+ends once the last page is shown or when the load is canceled.
+*/
+void ChatForm::onHistorySearchFinished()
+{
+    // the search was closed or changed meanwhile
+    if (historySearchPhrase != searchForm->getSearchPhrase() || !searchForm->isVisible())
+        return;
+
+    QDateTime found = historySearchWatcher->result();
+    if (!found.isValid())
+    {
+        historySearchFinished(false);
+        return;
+    }
+
+    loadHistoryPaged(QDateTime(found.toLocalTime().date()));
+    historySearchJump = historyProgress != nullptr;
+    if (!historySearchJump)
+        historySearchFinished(chatWidget->findPrevious());
+}
+
 void ChatForm::onScreenshotClicked()
 {
     doScreenshot();
@@ -855,7 +1094,7 @@ void ChatForm::onLoadHistory()
     if (dlg.exec())
     {
         QDateTime fromTime = dlg.getFromDate();
-        loadHistory(fromTime);
+        loadHistoryPaged(fromTime);
     }
 }
 
@@ -976,48 +1215,46 @@ void ChatForm::SendMessageStr(QString msg)
     if (isAction)
         msg = msg = msg.right(msg.length() - 4);
 
-    QList<CString> splittedMsg = Core::splitMessage(msg, TOX_MAX_MESSAGE_LENGTH);
+    // Core splits long messages and paces their chunks, it's still one message for us and the history
     QDateTime timestamp = QDateTime::currentDateTime();
+    QString msg_hist = msg;
+    if (isAction)
+        msg_hist = "/me " + msg;
 
-    for (CString& c_msg : splittedMsg)
-    {
-        QString qt_msg = CString::toString(c_msg.data(), c_msg.size());
-        QString qt_msg_hist = qt_msg;
-        if (isAction)
-            qt_msg_hist = "/me " + qt_msg;
-
-        bool status = !Settings::getInstance().getFauxOfflineMessaging();
-
-        ChatMessage::Ptr ma = addSelfMessage(qt_msg, isAction, timestamp, false);
-
-        int rec;
-        if (isAction)
-            rec = Core::getInstance()->sendAction(f->getFriendID(), qt_msg);
-        else
-            rec = Core::getInstance()->sendMessage(f->getFriendID(), qt_msg);
+    bool status = !Settings::getInstance().getFauxOfflineMessaging();
 
+    ChatMessage::Ptr ma = addSelfMessage(msg, isAction, timestamp, false);
 
-        Profile* profile = Nexus::getProfile();
-        if (profile->isHistoryEnabled())
-        {
-            auto* offMsgEngine = getOfflineMsgEngine();
-            profile->getHistory()->addNewMessage(f->getToxId().publicKey, qt_msg_hist,
-                        Core::getInstance()->getSelfId().publicKey, timestamp, status, Core::getInstance()->getUsername(),
-                                        [offMsgEngine,rec,ma](int64_t id)
-            {
-                offMsgEngine->registerReceipt(rec, id, ma);
-            });
-        }
-        else
+    Profile* profile = Nexus::getProfile();
+    if (profile->isHistoryEnabled())
+    {
+        // written right away, so the message isn't lost if the core drops its queue,
+        // the receipt is only known once the core thread sent the message's last chunk
+        auto* offMsgEngine = getOfflineMsgEngine();
+        profile->getHistory()->addNewMessage(f->getToxId().publicKey, msg_hist,
+                    Core::getInstance()->getSelfId().publicKey, timestamp, status, Core::getInstance()->getUsername(),
+                                    [offMsgEngine,ma](int64_t id)
         {
-            /// TODO: Make faux-offline messaging work partially with the history disabled
-            ma->markAsSent(QDateTime::currentDateTime());
-        }
+            offMsgEngine->registerMessageId(ma, id);
+        });
 
-        msgEdit->setLastMessage(msg); //set last message only when sending it
+        Core::getInstance()->queueMessage(f->getFriendID(), msg, isAction,
+                                          [offMsgEngine,ma](int rec)
+        {
+            offMsgEngine->registerSentReceipt(ma, rec);
+        });
+    }
+    else
+    {
+        Core::getInstance()->queueMessage(f->getFriendID(), msg, isAction);
 
-        Widget::getInstance()->updateFriendActivity(f);
+        /// TODO: Make faux-offline messaging work partially with the history disabled
+        ma->markAsSent(QDateTime::currentDateTime());
     }
+
+    msgEdit->setLastMessage(msg); //set last message only when sending it
+
+    Widget::getInstance()->updateFriendActivity(f);
 }
 
 void ChatForm::retranslateUi()
@@ -24,9 +24,11 @@
 #include <QLabel>
 #include <QTimer>
 #include <QElapsedTimer>
+#include <QFutureWatcher>
 
 #include "genericchatform.h"
 #include "src/core/corestructs.h"
+#include "src/persistence/history.h"
 #include "src/widget/tool/screenshotgrabber.h"
 
 class Friend;
@@ -37,6 +39,7 @@ class QHideEvent;
 class QMoveEvent;
 class OfflineMsgEngine;
 class CoreAV;
+class QProgressDialog;
 
 class ChatForm : public GenericChatForm
 {
@@ -81,6 +84,9 @@ private slots:
     void onFileSendFailed(uint32_t FriendId, const QString &fname);
     void onFriendStatusChanged(uint32_t friendId, Status status);
     void onLoadHistory();
+    void onHistoryPageLoaded();
+    void stopHistoryLoad();
+    void onHistorySearchFinished();
     void onUpdateTime();
     void onEnableCallButtons();
     void onScreenshotClicked();
@@ -98,9 +104,14 @@ private:
     void enableCallButtons();
     void disableCallButtons();
     void SendMessageStr(QString msg);
+    ChatMessage::Ptr createHistoryMessage(const History::HistMessage& it, ToxId& prevId,
+                                          QDateTime& prevDateTime, bool processUndelivered);
+    void loadHistoryPaged(QDateTime since);
+    void requestHistoryPage();
 
 protected:
     virtual GenericNetCamView* createNetcam() final override;
+    virtual void searchHistory(const QString& phrase) final override;
     // drag & drop
     virtual void dragEnterEvent(QDragEnterEvent* ev) final override;
     virtual void dropEvent(QDropEvent* ev) final override;
@@ -120,6 +131,16 @@ private:
     OfflineMsgEngine *offlineEngine;
     QAction* loadHistoryAction;
     QAction* copyStatusAction;
+    QFutureWatcher<QList<History::HistMessage>>* historyPageWatcher;
+    QFutureWatcher<QDateTime>* historySearchWatcher;
+    QString historySearchPhrase;
+    QProgressDialog* historyProgress;
+    QDateTime historyLoadSince;
+    QDateTime historyLoadStart;
+    QDateTime historyLoadBefore;
+    qint64 historyLoadBeforeId;
+    QDate historyPendingDate;
+    bool historySearchJump;
 
     QHash<uint, FileTransferInstance*> ftransWidgets;
     QMap<uint32_t, Status> oldStatus;
@@ -18,14 +18,63 @@
 */
 
 #include "filesform.h"
+#include "filetransfermodel.h"
+#include "src/core/core.h"
+#include "src/nexus.h"
+#include "src/persistence/profile.h"
 #include "src/widget/widget.h"
 #include "src/widget/translator.h"
 #include "src/widget/contentlayout.h"
+#include <tox/tox.h>
+#include <QCryptographicHash>
+#include <QFile>
 #include <QFileInfo>
+#include <QHeaderView>
+#include <QMutex>
+#include <QTreeView>
 #include <QWindow>
+#include <QtConcurrent/QtConcurrentRun>
+
+/**
+@class FilesForm
+@brief Lists the finished and cancelled file transfers.
+
+Transfers are kept in the profile database when the history is enabled,
+with the full path, size, peer, direction, duration and SHA-256 of the file.
+
+@var std::shared_ptr<std::atomic_bool> FilesForm::abandonHashes
+@brief Set when the form is destroyed, to stop the files still being hashed.
+*/
+
+// Size of the blocks files are hashed in, between checks for abandoning
+static const qint64 hashBlockSize = 1024 * 1024;
+
+/**
+@brief History ID and hash of a completed transfer.
+
+They come from the database and the hashing threads in any order,
+whichever comes last writes the hash to the history.
+*/
+struct PendingHash
+{
+    QMutex mutex;
+    int64_t id = -1;
+    QByteArray hash;
+    bool hashed = false;
+};
+
+static History* getHistory()
+{
+    Profile* profile = Nexus::getProfile();
+    if (!profile || !profile->isHistoryEnabled())
+        return nullptr;
+
+    return profile->getHistory();
+}
 
 FilesForm::FilesForm()
-    : QObject(), doneIcon(":/ui/fileTransferWidget/fileDone.svg")
+    : QObject()
+    , abandonHashes{std::make_shared<std::atomic_bool>(false)}
 {
     head = new QWidget();
     QFont bold;
@@ -33,15 +82,31 @@ FilesForm::FilesForm()
     headLabel.setFont(bold);
     head->setLayout(&headLayout);
     headLayout.addWidget(&headLabel);
+    headLayout.addWidget(&searchEdit);
+    searchEdit.setClearButtonEnabled(true);
+
+    model = new FileTransferModel(this);
+    recvdFilter = new FileTransferFilter(false, this);
+    sentFilter = new FileTransferFilter(true, this);
 
-    recvd = new QListWidget;
-    sent = new QListWidget;
+    recvd = createView(recvdFilter);
+    sent = createView(sentFilter);
 
     main.addTab(recvd, QString());
     main.addTab(sent, QString());
 
-    connect(sent, &QListWidget::itemActivated, this, &FilesForm::onFileActivated);
-    connect(recvd, &QListWidget::itemActivated, this, &FilesForm::onFileActivated);
+    connect(&searchEdit, &QLineEdit::textChanged, recvdFilter, &FileTransferFilter::setFilterFixedString);
+    connect(&searchEdit, &QLineEdit::textChanged, sentFilter, &FileTransferFilter::setFilterFixedString);
+    connect(&loadWatcher, &QFutureWatcher<QList<History::FileTransfer>>::finished,
+            this, &FilesForm::onTransfersLoaded);
+
+    if (History* history = getHistory())
+    {
+        loadWatcher.setFuture(QtConcurrent::run([history]()
+        {
+            return history->getFileTransfers();
+        }));
+    }
 
     retranslateUi();
     Translator::registerHandler(std::bind(&FilesForm::retranslateUi, this), this);
@@ -50,6 +115,8 @@ FilesForm::FilesForm()
 FilesForm::~FilesForm()
 {
     Translator::unregister(this);
+    *abandonHashes = true;
+    loadWatcher.waitForFinished();
     delete recvd;
     delete sent;
     head->deleteLater();
@@ -72,35 +139,133 @@ void FilesForm::show(ContentLayout* contentLayout)
     contentLayout->mainHead->layout()->addWidget(head);
     main.show();
     head->show();
+    model->checkFiles();
+}
+
+void FilesForm::onFileTransferFinished(ToxFile file)
+{
+    recordTransfer(file, true);
 }
 
-void FilesForm::onFileDownloadComplete(const QString& path)
+void FilesForm::onFileTransferCancelled(ToxFile file)
 {
-    QListWidgetItem* tmp = new QListWidgetItem(doneIcon, QFileInfo(path).fileName());
-    tmp->setData(Qt::UserRole, path);
-    recvd->addItem(tmp);
+    recordTransfer(file, false);
 }
 
-void FilesForm::onFileUploadComplete(const QString& path)
+/**
+@brief Adds an ended transfer to the list and to the history.
+@param file Transfer that ended.
+@param completed True if the whole file was transferred.
+
+Completed transfers are recorded right away, their file hash is filled in
+once it's computed. If qTox is closed meanwhile, the hash is left empty.
+*/
+void FilesForm::recordTransfer(const ToxFile& file, bool completed)
 {
-    QListWidgetItem* tmp = new QListWidgetItem(doneIcon, QFileInfo(path).fileName());
-    tmp->setData(Qt::UserRole, path);
-    sent->addItem(tmp);
+    // Avatars and offers that were never accepted aren't file transfers for the user
+    if (file.fileKind != TOX_FILE_KIND_DATA || file.filePath.isEmpty())
+        return;
+
+    History::FileTransfer transfer{0, Core::getInstance()->getFriendPublicKey(file.friendId),
+                                   QString::fromUtf8(file.fileName), file.filePath,
+                                   static_cast<qint64>(file.filesize), file.direction == ToxFile::SENDING,
+                                   completed, file.startTime, QDateTime::currentDateTime(), QByteArray()};
+    model->addTransfer(transfer);
+
+    History* history = getHistory();
+    if (!completed)
+    {
+        if (history)
+            history->addFileTransfer(transfer);
+
+        return;
+    }
+
+    std::shared_ptr<PendingHash> pending = std::make_shared<PendingHash>();
+    if (history)
+    {
+        history->addFileTransfer(transfer, [history, pending](int64_t id)
+        {
+            QMutexLocker locker{&pending->mutex};
+            pending->id = id;
+            if (pending->hashed && !pending->hash.isEmpty())
+                history->setFileTransferHash(id, pending->hash);
+        });
+    }
+
+    QFutureWatcher<QByteArray>* hashWatcher = new QFutureWatcher<QByteArray>(this);
+    connect(hashWatcher, &QFutureWatcher<QByteArray>::finished, this, [=]()
+    {
+        QByteArray hash = hashWatcher->result();
+        hashWatcher->deleteLater();
+        model->setHash(transfer.filePath, transfer.finished, hash);
+
+        QMutexLocker locker{&pending->mutex};
+        pending->hash = hash;
+        pending->hashed = true;
+        if (pending->id >= 0 && !hash.isEmpty())
+            if (History* history = getHistory())
+                history->setFileTransferHash(pending->id, hash);
+    });
+
+    QString path = file.filePath;
+    std::shared_ptr<std::atomic_bool> abandon = abandonHashes;
+    hashWatcher->setFuture(QtConcurrent::run([path, abandon]()
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return QByteArray();
+
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        while (!file.atEnd())
+        {
+            if (*abandon)
+                return QByteArray();
+
+            QByteArray block = file.read(hashBlockSize);
+            if (block.isEmpty())
+                return QByteArray();
+
+            hash.addData(block);
+        }
+
+        return hash.result();
+    }));
+}
+
+void FilesForm::onTransfersLoaded()
+{
+    model->setTransfers(loadWatcher.result());
+}
+
+QTreeView* FilesForm::createView(FileTransferFilter* filter)
+{
+    filter->setSourceModel(model);
+
+    QTreeView* view = new QTreeView;
+    view->setModel(filter);
+    view->setRootIsDecorated(false);
+    view->setUniformRowHeights(true);
+    view->setSortingEnabled(true);
+    view->sortByColumn(FileTransferModel::DateColumn, Qt::DescendingOrder);
+    view->header()->setStretchLastSection(false);
+    view->header()->setSectionResizeMode(FileTransferModel::NameColumn, QHeaderView::Stretch);
+
+    connect(view, &QTreeView::activated, this, &FilesForm::onFileActivated);
+    return view;
 }
 
-// sadly, the ToxFile struct in core only has the file name, not the file path...
-// so currently, these don't work as intended (though for now, downloads might work
-// whenever they're not saved anywhere custom, thanks to the hack)
-// I could do some digging around, but for now I'm tired and others already
-// might know it without me needing to dig, so...
-void FilesForm::onFileActivated(QListWidgetItem *item)
+void FilesForm::onFileActivated(const QModelIndex& index)
 {
-    Widget::confirmExecutableOpen(QFileInfo(item->data(Qt::UserRole).toString()));
+    QFileInfo file(index.data(FileTransferModel::PathRole).toString());
+    if (file.exists())
+        Widget::confirmExecutableOpen(file);
 }
 
 void FilesForm::retranslateUi()
 {
     headLabel.setText(tr("Transferred Files","\"Headline\" of the window"));
+    searchEdit.setPlaceholderText(tr("Search transfers"));
     main.setTabText(0, tr("Downloads"));
     main.setTabText(1, tr("Uploads"));
 }
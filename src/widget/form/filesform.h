@@ -20,14 +20,22 @@
 #ifndef FILESFORM_H
 #define FILESFORM_H
 
-#include <QListWidgetItem>
 #include <QTabWidget>
 #include <QString>
 #include <QLabel>
+#include <QLineEdit>
 #include <QVBoxLayout>
+#include <QFutureWatcher>
+#include <atomic>
+#include <memory>
+#include "src/core/corestructs.h"
+#include "src/persistence/history.h"
 
 class ContentLayout;
-class QListWidget;
+class QTreeView;
+class QModelIndex;
+class FileTransferModel;
+class FileTransferFilter;
 
 class FilesForm : public QObject
 {
@@ -41,22 +49,29 @@ public:
     void show(ContentLayout* contentLayout);
 
 public slots:
-    void onFileDownloadComplete(const QString& path);
-    void onFileUploadComplete(const QString& path);
+    void onFileTransferFinished(ToxFile file);
+    void onFileTransferCancelled(ToxFile file);
 
 private slots:
-    void onFileActivated(QListWidgetItem* item);
+    void onFileActivated(const QModelIndex& index);
+    void onTransfersLoaded();
 
 private:
+    void recordTransfer(const ToxFile& file, bool completed);
+    QTreeView* createView(FileTransferFilter* filter);
     void retranslateUi();
 
 private:
     QWidget* head;
-    QIcon doneIcon;
     QLabel headLabel;
+    QLineEdit searchEdit;
     QVBoxLayout headLayout;
     QTabWidget main;
-    QListWidget* sent, * recvd;
+    QTreeView* sent, * recvd;
+    FileTransferModel* model;
+    FileTransferFilter* sentFilter, * recvdFilter;
+    QFutureWatcher<QList<History::FileTransfer>> loadWatcher;
+    std::shared_ptr<std::atomic_bool> abandonHashes;
 };
 
 #endif // FILESFORM_H
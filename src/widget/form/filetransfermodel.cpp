@@ -0,0 +1,264 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "filetransfermodel.h"
+#include "src/friend.h"
+#include "src/friendlist.h"
+#include "src/core/toxid.h"
+#include "src/chatlog/content/filetransferwidget.h"
+#include <QColor>
+#include <QFileInfo>
+#include <QTime>
+#include <QtConcurrent/QtConcurrentRun>
+
+/**
+@class FileTransferModel
+@brief Lists the recorded file transfers, newest first.
+
+Views only ask for the rows they show, so thousands of transfers stay cheap.
+Whether each file still exists is checked on a worker thread by checkFiles().
+
+@class FileTransferFilter
+@brief Shows the transfers of one direction that match the filter string.
+*/
+
+FileTransferModel::FileTransferModel(QObject* parent)
+    : QAbstractTableModel(parent)
+    , doneIcon(":/ui/fileTransferWidget/fileDone.svg")
+    , cancelledIcon(":/ui/fileTransferInstance/no.svg")
+{
+    connect(&checkWatcher, &QFutureWatcher<QSet<QString>>::finished, this, &FileTransferModel::onFilesChecked);
+}
+
+int FileTransferModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : transfers.size();
+}
+
+int FileTransferModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant FileTransferModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= transfers.size())
+        return QVariant();
+
+    const History::FileTransfer& transfer = transfers[index.row()];
+    bool missing = missingFiles.contains(transfer.filePath);
+    qint64 duration = transfer.started.secsTo(transfer.finished);
+
+    if (role == PathRole)
+        return transfer.filePath;
+    else if (role == OutgoingRole)
+        return transfer.outgoing;
+
+    if (role == Qt::ToolTipRole)
+    {
+        QString tip = transfer.filePath;
+        if (!transfer.hash.isEmpty())
+            tip += QStringLiteral("\nSHA-256: ") + QString::fromLatin1(transfer.hash.toHex());
+
+        return tip;
+    }
+
+    if (role == Qt::DecorationRole && index.column() == NameColumn)
+    {
+        return transfer.completed ? doneIcon : cancelledIcon;
+    }
+
+    if (role == Qt::ForegroundRole && missing)
+        return QColor(Qt::gray);
+
+    if (role != Qt::DisplayRole && role != SortRole)
+        return QVariant();
+
+    switch (index.column())
+    {
+    case NameColumn:
+        return transfer.fileName;
+    case PeerColumn:
+    {
+        Friend* f = FriendList::findFriend(ToxId(transfer.peer));
+        return f ? f->getDisplayedName() : transfer.peer.left(8);
+    }
+    case SizeColumn:
+        if (role == SortRole)
+            return transfer.size;
+
+        return FileTransferWidget::getHumanReadableSize(transfer.size);
+    case DateColumn:
+        if (role == SortRole)
+            return transfer.finished;
+
+        return transfer.finished.toString(Qt::SystemLocaleShortDate);
+    case DurationColumn:
+        if (role == SortRole)
+            return duration;
+
+        return QTime(0, 0).addSecs(duration).toString(duration >= 3600 ? "h:mm:ss" : "m:ss");
+    case StatusColumn:
+        if (missing)
+            return tr("Missing", "File transfer whose file was moved or deleted");
+        else if (!transfer.completed)
+            return tr("Cancelled", "File transfer status");
+
+        return tr("Done", "File transfer status");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant FileTransferModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section)
+    {
+    case NameColumn:
+        return tr("File");
+    case PeerColumn:
+        return tr("Contact");
+    case SizeColumn:
+        return tr("Size");
+    case DateColumn:
+        return tr("Date");
+    case DurationColumn:
+        return tr("Duration");
+    case StatusColumn:
+        return tr("Status");
+    default:
+        return QVariant();
+    }
+}
+
+/**
+@brief Replaces the transfers with the recorded ones, then checks their files.
+@param newTransfers Recorded transfers, newest first.
+
+Transfers added since the record was read may not be saved yet, so the ones
+newer than every recorded transfer are kept on top.
+*/
+void FileTransferModel::setTransfers(const QList<History::FileTransfer>& newTransfers)
+{
+    QDateTime newest = newTransfers.isEmpty() ? QDateTime() : newTransfers.first().finished;
+    QList<History::FileTransfer> merged;
+    for (const History::FileTransfer& transfer : transfers)
+    {
+        if (!newest.isValid() || transfer.finished > newest)
+            merged << transfer;
+    }
+
+    merged += newTransfers;
+
+    beginResetModel();
+    transfers = merged;
+    missingFiles.clear();
+    endResetModel();
+
+    checkFiles();
+}
+
+/**
+@brief Adds a transfer on top of the list.
+@param transfer Transfer that just ended.
+*/
+void FileTransferModel::addTransfer(const History::FileTransfer& transfer)
+{
+    beginInsertRows(QModelIndex(), 0, 0);
+    transfers.prepend(transfer);
+    endInsertRows();
+}
+
+/**
+@brief Sets the hash of a transfer once it's computed.
+@param path Path of the transferred file.
+@param finished When the transfer ended.
+@param hash SHA-256 of the file.
+*/
+void FileTransferModel::setHash(const QString& path, const QDateTime& finished, const QByteArray& hash)
+{
+    // Hashes are computed right after the transfer, so the row is near the top
+    for (int i = 0; i < transfers.size(); ++i)
+    {
+        if (transfers[i].filePath == path && transfers[i].finished == finished)
+        {
+            transfers[i].hash = hash;
+            emit dataChanged(index(i, 0), index(i, ColumnCount - 1), {Qt::ToolTipRole});
+            return;
+        }
+    }
+}
+
+/**
+@brief Checks on a worker thread which files were moved or deleted.
+*/
+void FileTransferModel::checkFiles()
+{
+    if (checkWatcher.isRunning())
+        return;
+
+    QStringList paths;
+    for (const History::FileTransfer& transfer : transfers)
+        paths << transfer.filePath;
+
+    checkWatcher.setFuture(QtConcurrent::run([paths]()
+    {
+        QSet<QString> missing;
+        for (const QString& path : paths)
+        {
+            if (!QFileInfo::exists(path))
+                missing.insert(path);
+        }
+
+        return missing;
+    }));
+}
+
+void FileTransferModel::onFilesChecked()
+{
+    QSet<QString> missing = checkWatcher.result();
+    if (missing == missingFiles)
+        return;
+
+    missingFiles = missing;
+    if (!transfers.isEmpty())
+        emit dataChanged(index(0, 0), index(transfers.size() - 1, ColumnCount - 1));
+}
+
+FileTransferFilter::FileTransferFilter(bool outgoing, QObject* parent)
+    : QSortFilterProxyModel(parent)
+    , outgoing{outgoing}
+{
+    setFilterKeyColumn(-1);
+    setFilterCaseSensitivity(Qt::CaseInsensitive);
+    setSortRole(FileTransferModel::SortRole);
+}
+
+bool FileTransferFilter::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
+{
+    QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+    if (index.data(FileTransferModel::OutgoingRole).toBool() != outgoing)
+        return false;
+
+    return QSortFilterProxyModel::filterAcceptsRow(sourceRow, sourceParent);
+}
@@ -0,0 +1,90 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef FILETRANSFERMODEL_H
+#define FILETRANSFERMODEL_H
+
+#include <QAbstractTableModel>
+#include <QFutureWatcher>
+#include <QIcon>
+#include <QSet>
+#include <QSortFilterProxyModel>
+#include "src/persistence/history.h"
+
+class FileTransferModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Column
+    {
+        NameColumn,
+        PeerColumn,
+        SizeColumn,
+        DateColumn,
+        DurationColumn,
+        StatusColumn,
+        ColumnCount
+    };
+
+    enum Role
+    {
+        PathRole = Qt::UserRole,
+        OutgoingRole,
+        SortRole
+    };
+
+    explicit FileTransferModel(QObject* parent = nullptr);
+
+    virtual int rowCount(const QModelIndex& parent = QModelIndex()) const final override;
+    virtual int columnCount(const QModelIndex& parent = QModelIndex()) const final override;
+    virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const final override;
+    virtual QVariant headerData(int section, Qt::Orientation orientation,
+                                int role = Qt::DisplayRole) const final override;
+
+    void setTransfers(const QList<History::FileTransfer>& newTransfers);
+    void addTransfer(const History::FileTransfer& transfer);
+    void setHash(const QString& path, const QDateTime& finished, const QByteArray& hash);
+    void checkFiles();
+
+private slots:
+    void onFilesChecked();
+
+private:
+    QList<History::FileTransfer> transfers;
+    QSet<QString> missingFiles;
+    QFutureWatcher<QSet<QString>> checkWatcher;
+    QIcon doneIcon;
+    QIcon cancelledIcon;
+};
+
+class FileTransferFilter : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    FileTransferFilter(bool outgoing, QObject* parent = nullptr);
+
+protected:
+    virtual bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const final override;
+
+private:
+    bool outgoing;
+};
+
+#endif // FILETRANSFERMODEL_H
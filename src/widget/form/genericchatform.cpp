@@ -40,6 +40,7 @@
 #include "src/widget/contentdialog.h"
 #include "src/widget/contentlayout.h"
 #include "src/widget/emoticonswidget.h"
+#include "src/widget/form/searchform.h"
 #include "src/widget/maskablepixmapwidget.h"
 #include "src/widget/style.h"
 #include "src/widget/tool/chattextedit.h"
@@ -48,6 +49,23 @@
 #include "src/widget/translator.h"
 #include "src/widget/widget.h"
 
+/**
+@brief Stylesheets of the chat form widgets, by the value of their chatFormRole property.
+*/
+static const QList<QPair<QString, QString>> roleStylesheets = {
+    {"msgEdit", ":/ui/msgEdit/msgEdit.css"},
+    {"sendButton", ":/ui/sendButton/sendButton.css"},
+    {"fileButton", ":/ui/fileButton/fileButton.css"},
+    {"screenshotButton", ":/ui/screenshotButton/screenshotButton.css"},
+    {"emoteButton", ":/ui/emoteButton/emoteButton.css"},
+    {"callButton", ":/ui/callButton/callButton.css"},
+    {"videoButton", ":/ui/videoButton/videoButton.css"},
+    {"volButton", ":/ui/volButton/volButton.css"},
+    {"micButton", ":/ui/micButton/micButton.css"},
+    {"chatArea", ":/ui/chatArea/chatArea.css"},
+    {"chatHead", ":/ui/chatArea/chatHead.css"},
+};
+
 GenericChatForm::GenericChatForm(QWidget *parent)
   : QWidget(parent, Qt::Window)
   , audioInputFlag(false)
@@ -76,6 +94,9 @@ GenericChatForm::GenericChatForm(QWidget *parent)
     chatWidget = new ChatLog(this);
     chatWidget->setBusyNotification(ChatMessage::createBusyNotification());
 
+    searchForm = new SearchForm();
+    searchForm->hide();
+
     connect(&Settings::getInstance(), &Settings::emojiFontChanged,
             this, [this]() { chatWidget->forceRelayout(); });
 
@@ -107,28 +128,27 @@ GenericChatForm::GenericChatForm(QWidget *parent)
     fileLayout->setSpacing(0);
     fileLayout->setMargin(0);
 
-    msgEdit->setStyleSheet(Style::getStylesheet(":/ui/msgEdit/msgEdit.css"));
+    // The stylesheets are set on the ContentLayout, see GenericChatForm::getStylesheet
+    msgEdit->setProperty("chatFormRole", "msgEdit");
     msgEdit->setFixedHeight(50);
     msgEdit->setFrameStyle(QFrame::NoFrame);
 
-    sendButton->setStyleSheet(Style::getStylesheet(":/ui/sendButton/sendButton.css"));
-    fileButton->setStyleSheet(Style::getStylesheet(":/ui/fileButton/fileButton.css"));
-    screenshotButton->setStyleSheet(Style::getStylesheet(":/ui/screenshotButton/screenshotButton.css"));
-    emoteButton->setStyleSheet(Style::getStylesheet(":/ui/emoteButton/emoteButton.css"));
+    sendButton->setProperty("chatFormRole", "sendButton");
+    fileButton->setProperty("chatFormRole", "fileButton");
+    screenshotButton->setProperty("chatFormRole", "screenshotButton");
+    emoteButton->setProperty("chatFormRole", "emoteButton");
 
     callButton->setObjectName("green");
-    callButton->setStyleSheet(Style::getStylesheet(":/ui/callButton/callButton.css"));
+    callButton->setProperty("chatFormRole", "callButton");
 
     videoButton->setObjectName("green");
-    videoButton->setStyleSheet(Style::getStylesheet(":/ui/videoButton/videoButton.css"));
+    videoButton->setProperty("chatFormRole", "videoButton");
 
-    QString volButtonStylesheet = Style::getStylesheet(":/ui/volButton/volButton.css");
     volButton->setObjectName("grey");
-    volButton->setStyleSheet(volButtonStylesheet);
+    volButton->setProperty("chatFormRole", "volButton");
 
-    QString micButtonStylesheet = Style::getStylesheet(":/ui/micButton/micButton.css");
     micButton->setObjectName("grey");
-    micButton->setStyleSheet(micButtonStylesheet);
+    micButton->setProperty("chatFormRole", "micButton");
 
     setLayout(mainLayout);
 
@@ -137,6 +157,7 @@ GenericChatForm::GenericChatForm(QWidget *parent)
 
     QWidget* contentWidget = new QWidget(this);
     QVBoxLayout* contentLayout = new QVBoxLayout(contentWidget);
+    contentLayout->addWidget(searchForm);
     contentLayout->addWidget(chatWidget);
     contentLayout->addLayout(mainFootLayout);
     bodySplitter->addWidget(contentWidget);
@@ -205,9 +226,19 @@ GenericChatForm::GenericChatForm(QWidget *parent)
 
     new QShortcut(Qt::CTRL + Qt::SHIFT + Qt::Key_L, this, SLOT(clearChatArea()));
     new QShortcut(Qt::ALT + Qt::Key_Q, this, SLOT(quoteSelectedText()));
+    new QShortcut(QKeySequence::Find, this, SLOT(onSearchTriggered()));
+
+    connect(searchForm, &SearchForm::searchPhraseChanged, chatWidget, &ChatLog::startSearch);
+    connect(searchForm, &SearchForm::findPrevious, this, &GenericChatForm::onSearchPrevious);
+    connect(searchForm, &SearchForm::findNext, chatWidget, &ChatLog::findNext);
+    connect(searchForm, &SearchForm::closed, this, &GenericChatForm::onSearchClosed);
+    connect(chatWidget, &ChatLog::searchFinished, this, [this](int matchCount)
+    {
+        searchForm->setNotFound(matchCount == 0);
+    });
 
-    chatWidget->setStyleSheet(Style::getStylesheet(":/ui/chatArea/chatArea.css"));
-    headWidget->setStyleSheet(Style::getStylesheet(":/ui/chatArea/chatHead.css"));
+    chatWidget->setProperty("chatFormRole", "chatArea");
+    headWidget->setProperty("chatFormRole", "chatHead");
 
     fileFlyout->setFixedSize(24, 24);
     fileFlyout->setParent(this);
@@ -225,6 +256,25 @@ GenericChatForm::~GenericChatForm()
     Translator::unregister(this);
 }
 
+/**
+@brief Returns the stylesheet of all chat forms.
+
+Chat forms don't carry stylesheets of their own, their widgets are tagged with
+the chatFormRole property instead. The containers they are shown in apply this
+single stylesheet, so creating a chat form doesn't cause any stylesheet parsing.
+*/
+QString GenericChatForm::getStylesheet()
+{
+    QString qss;
+    for (const QPair<QString, QString>& roleStylesheet : roleStylesheets)
+    {
+        qss += Style::scopeStylesheet(Style::getStylesheet(roleStylesheet.second),
+                                      "chatFormRole", roleStylesheet.first);
+    }
+
+    return qss;
+}
+
 void GenericChatForm::adjustFileMenuPosition()
 {
     QPoint pos = fileButton->mapTo(bodySplitter, QPoint());
@@ -589,6 +639,52 @@ void GenericChatForm::quoteSelectedText()
     msgEdit->append(quote);
 }
 
+void GenericChatForm::onSearchTriggered()
+{
+    searchForm->activate();
+}
+
+/**
+@brief Jumps to the previous match, falling back to the history once the loaded messages are exhausted.
+*/
+void GenericChatForm::onSearchPrevious()
+{
+    if (chatWidget->findPrevious())
+        return;
+
+    searchHistory(searchForm->getSearchPhrase());
+}
+
+void GenericChatForm::onSearchClosed()
+{
+    chatWidget->stopSearch();
+    searchForm->hide();
+    msgEdit->setFocus();
+}
+
+/**
+@brief Starts loading older messages matching a phrase from the history.
+@param phrase Phrase to find.
+
+The search may end later, it reports its result with historySearchFinished().
+Chats without history have nothing more to load.
+*/
+void GenericChatForm::searchHistory(const QString& phrase)
+{
+    Q_UNUSED(phrase);
+    historySearchFinished(false);
+}
+
+/**
+@brief Ends a history search started by searchHistory().
+@param found True if matching messages were loaded and the search jumped to them.
+*/
+void GenericChatForm::historySearchFinished(bool found)
+{
+    if (!found)
+        searchForm->setNotFound(true);
+}
+
 void GenericChatForm::retranslateUi()
 {
     QString callObjectName = callButton->objectName();
@@ -46,6 +46,7 @@ class FlyoutOverlayWidget;
 class ContentLayout;
 class QSplitter;
 class GenericNetCamView;
+class SearchForm;
 
 namespace Ui {
     class MainWindow;
@@ -58,6 +59,8 @@ public:
     explicit GenericChatForm(QWidget *parent = 0);
     ~GenericChatForm();
 
+    static QString getStylesheet();
+
     void setName(const QString &newName);
     virtual void show() final{}
     virtual void show(ContentLayout* contentLayout);
@@ -95,6 +98,9 @@ protected slots:
     void onShowMessagesClicked();
     void onSplitterMoved(int pos, int index);
     void quoteSelectedText();
+    void onSearchTriggered();
+    void onSearchPrevious();
+    void onSearchClosed();
 
 private:
     void retranslateUi();
@@ -103,6 +109,8 @@ protected:
     void showNetcam();
     void hideNetcam();
     virtual GenericNetCamView* createNetcam() = 0;
+    virtual void searchHistory(const QString& phrase);
+    void historySearchFinished(bool found);
     QString resolveToxId(const ToxId &id);
     void insertChatMessage(ChatMessage::Ptr msg);
     void adjustFileMenuPosition();
@@ -128,6 +136,7 @@ protected:
     ChatTextEdit *msgEdit;
     QPushButton *sendButton;
     ChatLog *chatWidget;
+    SearchForm *searchForm;
     QDateTime earliestMessage;
     QDateTime historyBaselineDate = QDateTime::currentDateTime(); // used by HistoryKeeper to load messages from t to historyBaselineDate (excluded)
     bool audioInputFlag;
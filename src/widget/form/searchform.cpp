@@ -0,0 +1,114 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "searchform.h"
+#include "src/widget/translator.h"
+
+#include <QHBoxLayout>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QPushButton>
+
+/**
+@class SearchForm
+@brief Search bar of a chat form.
+
+Only collects the phrase and the navigation requests, the chat form does the searching.
+Enter jumps to the previous match, since searches start from the latest messages.
+*/
+
+SearchForm::SearchForm(QWidget* parent)
+    : QWidget(parent)
+{
+    searchLine = new QLineEdit();
+    previousButton = new QPushButton();
+    nextButton = new QPushButton();
+    closeButton = new QPushButton();
+
+    previousButton->setIcon(QIcon::fromTheme("go-up"));
+    nextButton->setIcon(QIcon::fromTheme("go-down"));
+    closeButton->setIcon(QIcon::fromTheme("window-close"));
+
+    QHBoxLayout* layout = new QHBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(searchLine);
+    layout->addWidget(previousButton);
+    layout->addWidget(nextButton);
+    layout->addWidget(closeButton);
+
+    connect(searchLine, &QLineEdit::textChanged, this, [this](const QString& phrase)
+    {
+        setNotFound(false);
+        emit searchPhraseChanged(phrase);
+    });
+    connect(searchLine, &QLineEdit::returnPressed, this, &SearchForm::findPrevious);
+    connect(previousButton, &QPushButton::clicked, this, &SearchForm::findPrevious);
+    connect(nextButton, &QPushButton::clicked, this, &SearchForm::findNext);
+    connect(closeButton, &QPushButton::clicked, this, &SearchForm::closed);
+
+    retranslateUi();
+    Translator::registerHandler(std::bind(&SearchForm::retranslateUi, this), this);
+}
+
+SearchForm::~SearchForm()
+{
+    Translator::unregister(this);
+}
+
+QString SearchForm::getSearchPhrase() const
+{
+    return searchLine->text();
+}
+
+/**
+@brief Shows whether the phrase has no match, by turning it red.
+*/
+void SearchForm::setNotFound(bool notFound)
+{
+    QPalette palette = searchLine->palette();
+    palette.setColor(QPalette::Text, notFound ? Qt::red : QWidget::palette().color(QPalette::Text));
+    searchLine->setPalette(palette);
+}
+
+/**
+@brief Shows the search bar and selects the phrase, ready to be typed over.
+*/
+void SearchForm::activate()
+{
+    show();
+    searchLine->setFocus();
+    searchLine->selectAll();
+}
+
+void SearchForm::keyPressEvent(QKeyEvent* event)
+{
+    if (event->key() == Qt::Key_Escape)
+        emit closed();
+    else
+        QWidget::keyPressEvent(event);
+}
+
+void SearchForm::retranslateUi()
+{
+    searchLine->setPlaceholderText(tr("Search in chat"));
+    previousButton->setToolTip(tr("Previous match"));
+    nextButton->setToolTip(tr("Next match"));
+    closeButton->setToolTip(tr("Close search"));
+}
@@ -0,0 +1,61 @@
+/*
+    Copyright © 2016 by The qTox Project
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SEARCHFORM_H
+#define SEARCHFORM_H
+
+#include <QWidget>
+
+class QLineEdit;
+class QPushButton;
+
+class SearchForm final : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit SearchForm(QWidget* parent = nullptr);
+    ~SearchForm();
+
+    QString getSearchPhrase() const;
+    void setNotFound(bool notFound);
+
+signals:
+    void searchPhraseChanged(const QString& phrase);
+    void findPrevious();
+    void findNext();
+    void closed();
+
+public slots:
+    void activate();
+
+protected:
+    virtual void keyPressEvent(QKeyEvent* event) final override;
+
+private:
+    void retranslateUi();
+
+private:
+    QLineEdit* searchLine;
+    QPushButton* previousButton;
+    QPushButton* nextButton;
+    QPushButton* closeButton;
+};
+
+#endif // SEARCHFORM_H
@@ -24,6 +24,17 @@
 #include "src/persistence/db/plaindb.h"
 #include "src/widget/translator.h"
 
+#ifdef QTOX_ALLOC_PROFILING
+#include <QFontDatabase>
+#include <QGroupBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+// How often the memory usage shown is refreshed, in ms
+static const int allocStatsInterval = 2000;
+#endif
+
 AdvancedForm::AdvancedForm() :
     GenericForm(QPixmap(":/img/settings/general.png"))
 {
@@ -40,6 +51,10 @@ AdvancedForm::AdvancedForm() :
         cb->installEventFilter(this);
     }
 
+#ifdef QTOX_ALLOC_PROFILING
+    setupAllocStats();
+#endif
+
     Translator::registerHandler(std::bind(&AdvancedForm::retranslateUi, this), this);
 }
 
@@ -73,3 +88,52 @@ void AdvancedForm::retranslateUi()
 {
     bodyUI->retranslateUi(this);
 }
+
+#ifdef QTOX_ALLOC_PROFILING
+/**
+@brief Adds the tracked memory of each subsystem to the form, for profiling builds.
+*/
+void AdvancedForm::setupAllocStats()
+{
+    QGroupBox* group = new QGroupBox(QStringLiteral("Tracked memory"));
+    QVBoxLayout* layout = new QVBoxLayout(group);
+
+    QLabel* note = new QLabel(QStringLiteral("Counts C++ operator new, SQLite and video frame buffers. "
+                                             "Other malloc'd memory, such as string, image and audio "
+                                             "buffers, isn't included."));
+    note->setWordWrap(true);
+    layout->addWidget(note);
+
+    allocStatsLabel = new QLabel;
+    allocStatsLabel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    allocStatsLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    layout->addWidget(allocStatsLabel);
+
+    QPushButton* dumpButton = new QPushButton(QStringLiteral("Dump to log"));
+    connect(dumpButton, &QPushButton::clicked, &AllocStats::dump);
+    layout->addWidget(dumpButton);
+
+    // keep the spacer last
+    bodyUI->verticalLayout_2->insertWidget(bodyUI->verticalLayout_2->count() - 1, group);
+
+    allocStatsSnapshot = AllocStats::snapshot();
+    connect(&allocStatsTimer, &QTimer::timeout, this, &AdvancedForm::updateAllocStats);
+    allocStatsTimer.start(allocStatsInterval);
+    updateAllocStats();
+}
+
+/**
+@brief Shows the live bytes of each subsystem and their rates since the last refresh.
+*/
+void AdvancedForm::updateAllocStats()
+{
+    if (!isVisible() && !allocStatsLabel->text().isEmpty())
+    {
+        allocStatsSnapshot = AllocStats::snapshot();
+        return;
+    }
+
+    allocStatsLabel->setText(AllocStats::report(allocStatsSnapshot));
+    allocStatsSnapshot = AllocStats::snapshot();
+}
+#endif
@@ -22,6 +22,13 @@
 
 #include "genericsettings.h"
 
+#ifdef QTOX_ALLOC_PROFILING
+#include <QTimer>
+#include "src/allocstats.h"
+
+class QLabel;
+#endif
+
 class Core;
 
 namespace Ui {
@@ -48,9 +55,18 @@ private slots:
 
 private:
     void retranslateUi();
+#ifdef QTOX_ALLOC_PROFILING
+    void setupAllocStats();
+    void updateAllocStats();
+#endif
 
 private:
     Ui::AdvancedSettings* bodyUI;
+#ifdef QTOX_ALLOC_PROFILING
+    QLabel* allocStatsLabel;
+    QTimer allocStatsTimer;
+    AllocStats::Snapshot allocStatsSnapshot;
+#endif
 };
 
 #endif // ADVANCEDFORM_H
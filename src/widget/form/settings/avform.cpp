@@ -23,6 +23,7 @@
 #include "src/persistence/settings.h"
 #include "src/video/camerasource.h"
 #include "src/video/cameradevice.h"
+#include "src/video/cameracache.h"
 #include "src/video/videosurface.h"
 #include "src/widget/translator.h"
 #include "src/widget/tool/screenshotgrabber.h"
@@ -63,6 +64,8 @@ AVForm::AVForm()
     playbackSlider->setValue(s.getOutVolume());
     playbackSlider->installEventFilter(this);
 
+    audioProfileComboBox->setCurrentIndex(s.getAudioProfile());
+
     microphoneSlider->setToolTip(
                 tr("Use slider to set the gain of your input device ranging"
                    " from %1dB to %2dB.").arg(audio.minInputGain())
@@ -82,6 +85,9 @@ AVForm::AVForm()
         cb->setFocusPolicy(Qt::StrongFocus);
     }
 
+    connect(&CameraCache::getInstance(), &CameraCache::devicesChanged,
+            this, &AVForm::onCameraDevicesChanged);
+
     Translator::registerHandler(std::bind(&AVForm::retranslateUi, this), this);
 }
 
@@ -115,6 +121,7 @@ void AVForm::showEvent(QShowEvent* event)
     getAudioInDevices();
     createVideoSurface();
     getVideoDevices();
+    CameraCache::getInstance().refresh();
 
     if (!subscribedToAudioIn) {
         // TODO: this should not be done in show/hide events
@@ -334,7 +341,7 @@ void AVForm::updateVideoModes(int curIndex)
         return;
     }
     QString devName = videoDeviceList[curIndex].first;
-    QVector<VideoMode> allVideoModes = CameraDevice::getVideoModes(devName);
+    QVector<VideoMode> allVideoModes = CameraCache::getInstance().getVideoModes(devName);
 
     qDebug("available Modes:");
     bool isScreen = CameraDevice::isScreen(devName);
@@ -409,11 +416,17 @@ void AVForm::on_videoDevCombobox_currentIndexChanged(int index)
         Core::getInstance()->getAv()->sendNoVideo();
 }
 
+void AVForm::onCameraDevicesChanged()
+{
+    if (isVisible())
+        getVideoDevices();
+}
+
 void AVForm::getVideoDevices()
 {
     QString settingsInDev = Settings::getInstance().getVideoDev();
     int videoDevIndex = 0;
-    videoDeviceList = CameraDevice::getDeviceList();
+    videoDeviceList = CameraCache::getInstance().getDeviceList();
     //prevent currentIndexChanged to be fired while adding items
     videoDevCombobox->blockSignals(true);
     videoDevCombobox->clear();
@@ -525,6 +538,12 @@ void AVForm::on_microphoneSlider_valueChanged(int value)
     Audio::getInstance().setInputGain(dB);
 }
 
+void AVForm::on_audioProfileComboBox_currentIndexChanged(int index)
+{
+    Settings::getInstance().setAudioProfile(index);
+    Audio::getInstance().setProfile(index);
+}
+
 void AVForm::createVideoSurface()
 {
     if (camVideoSurface)
@@ -63,10 +63,12 @@ private slots:
     void on_playbackSlider_valueChanged(int value);
     void on_btnPlayTestSound_clicked(bool checked);
     void on_microphoneSlider_valueChanged(int value);
+    void on_audioProfileComboBox_currentIndexChanged(int index);
 
     // camera
     void on_videoDevCombobox_currentIndexChanged(int index);
     void on_videoModescomboBox_currentIndexChanged(int index);
+    void onCameraDevicesChanged();
 
 
 protected:
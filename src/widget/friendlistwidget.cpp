@@ -31,6 +31,7 @@
 #include <QDragEnterEvent>
 #include <QDragLeaveEvent>
 #include <QTimer>
+#include <algorithm>
 #include <cassert>
 
 enum Time : int
@@ -53,60 +54,25 @@ bool last7DaysWasLastMonth()
     return QDate::currentDate().addDays(-7).month() == QDate::currentDate().month();
 }
 
-Time getTime(const QDate& date)
+/**
+@brief Finds the activity category of a date.
+@param boundaries First day of each category from Today to Month5Ago, newest first.
+@param date Date of the last activity, null if there was none.
+@return The category.
+*/
+Time getTime(const QVector<QDate>& boundaries, const QDate& date)
 {
     if (date == QDate())
         return Never;
 
-    QDate today = QDate::currentDate();
-
-    if (date == today)
-        return Today;
-
-    today = today.addDays(-1);
-
-    if (date == today)
-        return Yesterday;
-
-    today = today.addDays(-6);
-
-    if (date >= today)
-        return ThisWeek;
-
-    today = today.addDays(-today.day() + 1); // Go to the beginning of the month.
-
-    if (last7DaysWasLastMonth())
+    // First category the date isn't older than
+    auto it = std::lower_bound(boundaries.begin(), boundaries.end(), date,
+                               [](const QDate& boundary, const QDate& date)
     {
-        if (date >= today)
-            return ThisMonth;
-
-        today = today.addMonths(-1);
-    }
-
-    if (date >= today)
-        return Month1Ago;
-
-    today = today.addMonths(-1);
-
-    if (date >= today)
-        return Month2Ago;
-
-    today = today.addMonths(-1);
-
-    if (date >= today)
-        return Month3Ago;
+        return date < boundary;
+    });
 
-    today = today.addMonths(-1);
-
-    if (date >= today)
-        return Month4Ago;
-
-    today = today.addMonths(-1);
-
-    if (date >= today)
-        return Month5Ago;
-
-    return LongAgo;
+    return static_cast<Time>(it - boundaries.begin());
 }
 
 QDate getDateFriend(Friend* contact)
@@ -223,6 +189,9 @@ void FriendListWidget::setMode(Mode mode)
             activityLayout = nullptr;
         }
 
+        activityIndex.clear();
+        activityDates.clear();
+
         reDraw();
     }
     else if (mode == Activity)
@@ -242,43 +211,13 @@ void FriendListWidget::setMode(Mode mode)
         categoryLastWeek->setName(tr("Last 7 days", "Category for sorting friends by activity"));
         activityLayout->addWidget(categoryLastWeek);
 
-        QDate currentDate = QDate::currentDate();
-        //if (last7DaysWasLastMonth())
-        {
-            CategoryWidget* categoryThisMonth = new CategoryWidget(this);
-            categoryThisMonth->setName(tr("This month", "Category for sorting friends by activity"));
-            activityLayout->addWidget(categoryThisMonth);
-            categoryThisMonth->setVisible(last7DaysWasLastMonth());
-
-            if (categoryThisMonth->isVisible())
-                currentDate = currentDate.addMonths(-1);
-        }
-
-        QLocale *ql = new QLocale(Settings::getInstance().getTranslation());
-
-        CategoryWidget* categoryLast1Month = new CategoryWidget(this);
-        categoryLast1Month->setName(ql->monthName(currentDate.month()));
-        activityLayout->addWidget(categoryLast1Month);
-
-        currentDate = currentDate.addMonths(-1);
-        CategoryWidget* categoryLast2Month = new CategoryWidget(this);
-        categoryLast2Month->setName(ql->monthName(currentDate.month()));
-        activityLayout->addWidget(categoryLast2Month);
+        CategoryWidget* categoryThisMonth = new CategoryWidget(this);
+        categoryThisMonth->setName(tr("This month", "Category for sorting friends by activity"));
+        activityLayout->addWidget(categoryThisMonth);
 
-        currentDate = currentDate.addMonths(-1);
-        CategoryWidget* categoryLast3Month = new CategoryWidget(this);
-        categoryLast3Month->setName(ql->monthName(currentDate.month()));
-        activityLayout->addWidget(categoryLast3Month);
-
-        currentDate = currentDate.addMonths(-1);
-        CategoryWidget* categoryLast4Month = new CategoryWidget(this);
-        categoryLast4Month->setName(ql->monthName(currentDate.month()));
-        activityLayout->addWidget(categoryLast4Month);
-
-        currentDate = currentDate.addMonths(-1);
-        CategoryWidget* categoryLast5Month = new CategoryWidget(this);
-        categoryLast5Month->setName(ql->monthName(currentDate.month()));
-        activityLayout->addWidget(categoryLast5Month);
+        // Named after their month by updateCategoryNames()
+        for (int i = Month1Ago; i <= Month5Ago; ++i)
+            activityLayout->addWidget(new CategoryWidget(this));
 
         CategoryWidget* categoryOlder = new CategoryWidget(this);
         categoryOlder->setName(tr("Older than 6 Months", "Category for sorting friends by activity"));
@@ -288,16 +227,15 @@ void FriendListWidget::setMode(Mode mode)
         categoryNever->setName(tr("Unknown", "Category for sorting friends by activity"));
         activityLayout->addWidget(categoryNever);
 
-        delete ql;
-        ql = nullptr;
+        updateActivityBoundaries();
+        updateCategoryNames();
 
         QList<Friend*> friendList = FriendList::getAllFriends();
         for (Friend* contact : friendList)
         {
             QDate activityDate = getDateFriend(contact);
-            Time time = getTime(activityDate);
-            CategoryWidget* categoryWidget = dynamic_cast<CategoryWidget*>(activityLayout->itemAt(time)->widget());
-            categoryWidget->addFriendWidget(contact->getFriendWidget(), contact->getStatus());
+            setActivityDate(contact->getFriendWidget(), activityDate);
+            getCategory(getTime(activityBoundaries, activityDate))->addFriendWidget(contact->getFriendWidget(), contact->getStatus());
         }
 
         for (int i = 0; i < activityLayout->count(); ++i)
@@ -352,11 +290,10 @@ void FriendListWidget::removeFriendWidget(FriendWidget* w)
     Friend* contact = FriendList::findFriend(w->friendId);
     if (mode == Activity)
     {
-        QDate activityDate = getDateFriend(contact);
-        Time time = getTime(activityDate);
-        CategoryWidget* categoryWidget = dynamic_cast<CategoryWidget*>(activityLayout->itemAt(time)->widget());
+        CategoryWidget* categoryWidget = getCategory(getTime(activityBoundaries, activityDates.value(w)));
         categoryWidget->removeFriendWidget(w, contact->getStatus());
         categoryWidget->setVisible(categoryWidget->hasChatrooms());
+        removeActivityDate(w);
     }
     else
     {
@@ -474,9 +411,8 @@ void FriendListWidget::cycleContacts(GenericChatroomWidget* activeChatroomWidget
         if (friendWidget == nullptr)
             return;
 
-        QDate activityDate = getDateFriend(FriendList::findFriend(friendWidget->friendId));
-        index = getTime(activityDate);
-        CategoryWidget* categoryWidget = dynamic_cast<CategoryWidget*>(activityLayout->itemAt(index)->widget());
+        index = getTime(activityBoundaries, activityDates.value(friendWidget));
+        CategoryWidget* categoryWidget = getCategory(index);
 
         if (categoryWidget == nullptr || categoryWidget->cycleContacts(friendWidget, forward))
             return;
@@ -630,12 +566,52 @@ void FriendListWidget::dropEvent(QDropEvent* event)
     }
 }
 
+/**
+@brief Moves the friends whose activity changed category at midnight.
+
+Only the friends whose date lies between an old and a new category
+boundary are moved, the rest of the list is left as is.
+*/
 void FriendListWidget::dayTimeout()
 {
     if (mode == Activity)
     {
-        setMode(Name);
-        setMode(Activity); // Refresh all.
+        QVector<QDate> oldBoundaries = activityBoundaries;
+        updateActivityBoundaries();
+        updateCategoryNames();
+
+        QSet<QDate> shifted;
+        for (int i = 0; i < activityBoundaries.size(); ++i)
+        {
+            QDate from = qMin(oldBoundaries[i], activityBoundaries[i]);
+            QDate to = qMax(oldBoundaries[i], activityBoundaries[i]);
+
+            for (auto it = activityIndex.lowerBound(from); it != activityIndex.end() && it.key() < to; ++it)
+                shifted.insert(it.key());
+        }
+
+        QSet<CategoryWidget*> changed;
+        for (const QDate& date : shifted)
+        {
+            Time oldTime = getTime(oldBoundaries, date);
+            Time newTime = getTime(activityBoundaries, date);
+            if (oldTime == newTime)
+                continue;
+
+            CategoryWidget* oldCategory = getCategory(oldTime);
+            CategoryWidget* newCategory = getCategory(newTime);
+            for (FriendWidget* w : activityIndex.value(date))
+            {
+                Status s = FriendList::findFriend(w->friendId)->getStatus();
+                oldCategory->removeFriendWidget(w, s);
+                newCategory->addFriendWidget(w, s);
+            }
+
+            changed << oldCategory << newCategory;
+        }
+
+        for (CategoryWidget* categoryWidget : changed)
+            categoryWidget->setVisible(categoryWidget->hasChatrooms());
     }
 
     dayTimer->start(timeUntilTomorrow());
@@ -663,22 +639,105 @@ void FriendListWidget::moveWidget(FriendWidget* w, Status s, bool add)
     {
         Friend* contact = FriendList::findFriend(w->friendId);
         QDate activityDate = getDateFriend(contact);
-        Time time = getTime(activityDate);
-        CategoryWidget* categoryWidget = dynamic_cast<CategoryWidget*>(activityLayout->itemAt(time)->widget());
-        categoryWidget->addFriendWidget(contact->getFriendWidget(), contact->getStatus());
+        Time time = getTime(activityBoundaries, activityDate);
+        CategoryWidget* categoryWidget = getCategory(time);
+
+        auto old = activityDates.constFind(w);
+        if (old != activityDates.constEnd())
+        {
+            Time oldTime = getTime(activityBoundaries, *old);
+            if (oldTime != time)
+            {
+                CategoryWidget* oldCategory = getCategory(oldTime);
+                oldCategory->removeFriendWidget(w, contact->getStatus());
+                oldCategory->setVisible(oldCategory->hasChatrooms());
+            }
+        }
+
+        setActivityDate(w, activityDate);
+        categoryWidget->addFriendWidget(w, contact->getStatus());
         categoryWidget->show();
     }
 }
 
-void FriendListWidget::updateActivityDate(const QDate& date)
+CategoryWidget* FriendListWidget::getCategory(int time) const
+{
+    return static_cast<CategoryWidget*>(activityLayout->itemAt(time)->widget());
+}
+
+/**
+@brief Computes the first day of each activity category, once per day.
+*/
+void FriendListWidget::updateActivityBoundaries()
+{
+    QDate today = QDate::currentDate();
+
+    activityBoundaries.resize(LongAgo);
+    activityBoundaries[Today] = today;
+    activityBoundaries[Yesterday] = today.addDays(-1);
+    activityBoundaries[ThisWeek] = today.addDays(-7);
+
+    QDate month = activityBoundaries[ThisWeek];
+    month = month.addDays(-month.day() + 1); // Go to the beginning of the month.
+
+    if (last7DaysWasLastMonth())
+    {
+        activityBoundaries[ThisMonth] = month;
+        month = month.addMonths(-1);
+    }
+    else
+    {
+        // Empty, the last 7 days already cover this month
+        activityBoundaries[ThisMonth] = activityBoundaries[ThisWeek];
+    }
+
+    for (int i = Month1Ago; i <= Month5Ago; ++i)
+    {
+        activityBoundaries[i] = month;
+        month = month.addMonths(-1);
+    }
+}
+
+void FriendListWidget::updateCategoryNames()
+{
+    QLocale locale(Settings::getInstance().getTranslation());
+
+    for (int i = Month1Ago; i <= Month5Ago; ++i)
+        getCategory(i)->setName(locale.monthName(activityBoundaries[i].month()));
+}
+
+/**
+@brief Records the activity date a friend is sorted by.
+@param w Widget of the friend.
+@param date Date of the last activity.
+*/
+void FriendListWidget::setActivityDate(FriendWidget* w, const QDate& date)
+{
+    auto old = activityDates.find(w);
+    if (old != activityDates.end())
+    {
+        if (*old == date)
+            return;
+
+        removeActivityDate(w);
+    }
+
+    activityDates.insert(w, date);
+    activityIndex[date].insert(w);
+}
+
+void FriendListWidget::removeActivityDate(FriendWidget* w)
 {
-    if (mode != Activity)
+    auto old = activityDates.find(w);
+    if (old == activityDates.end())
         return;
 
-    CategoryWidget* categoryWidget = static_cast<CategoryWidget*>(activityLayout->itemAt(getTime(date))->widget());
-    categoryWidget->updateStatus();
+    auto bucket = activityIndex.find(*old);
+    bucket->remove(w);
+    if (bucket->isEmpty())
+        activityIndex.erase(bucket);
 
-    categoryWidget->setVisible(categoryWidget->hasChatrooms());
+    activityDates.erase(old);
 }
 
 // update widget after add/delete/hide/show
@@ -21,6 +21,11 @@
 #define FRIENDLISTWIDGET_H
 
 #include <QWidget>
+#include <QDate>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QVector>
 #include "src/core/corestructs.h"
 #include "genericchatitemlayout.h"
 
@@ -31,6 +36,7 @@ class Widget;
 class FriendWidget;
 class GroupWidget;
 class CircleWidget;
+class CategoryWidget;
 class FriendListLayout;
 class GenericChatroomWidget;
 
@@ -59,7 +65,6 @@ public:
 
     void cycleContacts(GenericChatroomWidget* activeChatroomWidget, bool forward);
 
-    void updateActivityDate(const QDate& date);
     void reDraw();
 
 signals:
@@ -81,6 +86,11 @@ private slots:
 private:
     CircleWidget* createCircleWidget(int id = -1);
     QLayout* nextLayout(QLayout* layout, bool forward) const;
+    CategoryWidget* getCategory(int time) const;
+    void updateActivityBoundaries();
+    void updateCategoryNames();
+    void setActivityDate(FriendWidget* w, const QDate& date);
+    void removeActivityDate(FriendWidget* w);
 
     Mode mode;
     bool groupsOnTop;
@@ -89,6 +99,9 @@ private:
     GenericChatItemLayout groupLayout;
     QVBoxLayout* activityLayout = nullptr;
     QTimer* dayTimer;
+    QVector<QDate> activityBoundaries;
+    QMap<QDate, QSet<FriendWidget*>> activityIndex;
+    QHash<FriendWidget*, QDate> activityDates;
 };
 
 #endif // FRIENDLISTWIDGET_H
@@ -100,6 +100,10 @@ int GenericChatItemLayout::indexOfClosestSortedWidget(GenericChatItemWidget* wid
 {
     // Binary search: Deferred test of equality.
     int min = 0, max = layout->count();
+
+    QCollator collator;
+    collator.setNumericMode(true);
+
     while (min < max)
     {
         int mid = (max - min) / 2 + min;
@@ -108,9 +112,6 @@ int GenericChatItemLayout::indexOfClosestSortedWidget(GenericChatItemWidget* wid
 
         bool lessThan = false;
 
-        QCollator collator;
-        collator.setNumericMode(true);
-
         int compareValue = collator.compare(atMid->getName(), widget->getName());
 
         if (compareValue < 0)
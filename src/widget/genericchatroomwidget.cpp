@@ -44,6 +44,19 @@ GenericChatroomWidget::GenericChatroomWidget(QWidget *parent)
 
     nameLabel->setForegroundRole(QPalette::WindowText);
 
+    // label colors don't depend on the theme color, so they're only set once
+    QPalette p;
+
+    p = statusMessageLabel->palette();
+    p.setColor(QPalette::WindowText, Style::getColor(Style::LightGrey)); // Base color
+    p.setColor(QPalette::HighlightedText, Style::getColor(Style::MediumGrey)); // Color when active
+    statusMessageLabel->setPalette(p);
+
+    p = nameLabel->palette();
+    p.setColor(QPalette::WindowText, Style::getColor(Style::White)); // Base color
+    p.setColor(QPalette::HighlightedText, Style::getColor(Style::DarkGrey)); // Color when active
+    nameLabel->setPalette(p);
+
     setAutoFillBackground(true);
     reloadTheme();
 
@@ -160,21 +173,21 @@ QString GenericChatroomWidget::getTitle() const
     return title;
 }
 
+/**
+@brief Applies the theme colors to the background.
+
+Does nothing when they're already in place. The colors are set on the widget
+itself, so they're kept when it's moved to another circle.
+*/
 void GenericChatroomWidget::reloadTheme()
 {
-    QPalette p;
-
-    p = statusMessageLabel->palette();
-    p.setColor(QPalette::WindowText, Style::getColor(Style::LightGrey)); // Base color
-    p.setColor(QPalette::HighlightedText, Style::getColor(Style::MediumGrey)); // Color when active
-    statusMessageLabel->setPalette(p);
+    QPalette p = palette();
+    if (testAttribute(Qt::WA_SetPalette)
+            && p.color(QPalette::Window) == Style::getColor(Style::ThemeMedium)
+            && p.color(QPalette::Highlight) == Style::getColor(Style::ThemeLight))
+        return;
 
-    p = nameLabel->palette();
-    p.setColor(QPalette::WindowText, Style::getColor(Style::White)); // Base color
-    p.setColor(QPalette::HighlightedText, Style::getColor(Style::DarkGrey)); // Color when active
-    nameLabel->setPalette(p);
 
-    p = palette();
     p.setColor(QPalette::Window, Style::getColor(Style::ThemeMedium)); // Base background color
     p.setColor(QPalette::Highlight, Style::getColor(Style::ThemeLight)); // On mouse over
     p.setColor(QPalette::Light, Style::getColor(Style::White)); // When active
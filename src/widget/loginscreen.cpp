@@ -29,8 +29,18 @@
 #include "src/widget/style.h"
 #include "src/widget/tool/profileimporter.h"
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QToolButton>
 #include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
+
+/**
+@var QFutureWatcher<bool> LoginScreen::unlockWatcher
+@brief Watches the profile unlock running on a worker thread.
+
+@var std::shared_ptr<Profile::Unlock> LoginScreen::pendingUnlock
+@brief Profile being unlocked, shared with the worker thread.
+*/
 
 LoginScreen::LoginScreen(QWidget *parent) :
     QWidget(parent),
@@ -57,6 +67,7 @@ LoginScreen::LoginScreen(QWidget *parent) :
     connect(ui->newPassConfirm, &QLineEdit::textChanged, this, &LoginScreen::onPasswordEdited);
     connect(ui->autoLoginCB, &QCheckBox::stateChanged, this, &LoginScreen::onAutoLoginToggled);
     connect(ui->importButton,  &QPushButton::clicked, this, &LoginScreen::onImportProfile);
+    connect(&unlockWatcher, &QFutureWatcher<bool>::finished, this, &LoginScreen::onUnlockFinished);
 
     reset();
     this->setStyleSheet(Style::getStylesheet(":/ui/loginScreen/loginScreen.css"));
@@ -67,6 +78,10 @@ LoginScreen::LoginScreen(QWidget *parent) :
 
 LoginScreen::~LoginScreen()
 {
+    if (pendingUnlock)
+        pendingUnlock->cancelled = true;
+
+    unlockWatcher.waitForFinished();
     Translator::unregister(this);
     delete ui;
 }
@@ -204,8 +219,18 @@ void LoginScreen::onLoginUsernameSelected(const QString &name)
     }
 }
 
+/**
+@brief Starts unlocking the selected profile on a worker thread.
+
+Key derivation can take seconds, so the window stays responsive and shows the
+progress meanwhile. Only one unlock runs at a time, attempts made while one is
+still running, even a cancelled one, are ignored.
+*/
 void LoginScreen::onLogin()
 {
+    if (unlockWatcher.isRunning())
+        return;
+
     QString name = ui->loginUsernames->currentText();
     QString pass = ui->loginPassword->text();
 
@@ -225,25 +250,107 @@ void LoginScreen::onLogin()
         return;
     }
 
-    Profile* profile = Profile::loadProfile(name, pass);
-    if (!profile)
+    if (ProfileLocker::hasLock() || !ProfileLocker::lock(name))
     {
-        if (!ProfileLocker::isLockable(name))
-        {
-            QMessageBox::critical(this, tr("Couldn't load this profile"),
-                                  tr("Profile already in use. Close other clients."));
-            return;
-        }
-        else
+        QMessageBox::critical(this, tr("Couldn't load this profile"),
+                              tr("Profile already in use. Close other clients."));
+        return;
+    }
+
+    std::shared_ptr<Profile::Unlock> unlock = std::make_shared<Profile::Unlock>();
+    unlock->name = name;
+    unlock->password = pass;
+    unlock->stageChanged = [this](Profile::UnlockStage stage)
+    {
+        QMetaObject::invokeMethod(this, "onUnlockStageChanged", Qt::QueuedConnection,
+                                  Q_ARG(int, static_cast<int>(stage)));
+    };
+    pendingUnlock = unlock;
+
+    unlockProgress = new QProgressDialog(tr("Loading profile..."), tr("Cancel"), 0, 0, this);
+    unlockProgress->setWindowModality(Qt::WindowModal);
+    unlockProgress->setAutoReset(false);
+    unlockProgress->setAutoClose(false);
+    unlockProgress->setMinimumDuration(500);
+    connect(unlockProgress, &QProgressDialog::canceled, this, &LoginScreen::onUnlockCancelled);
+
+    unlockWatcher.setFuture(QtConcurrent::run([unlock]()
+    {
+        return Profile::unlockProfile(*unlock);
+    }));
+}
+
+void LoginScreen::onUnlockStageChanged(int stage)
+{
+    if (!unlockProgress || !pendingUnlock || pendingUnlock->cancelled)
+        return;
+
+    switch (static_cast<Profile::UnlockStage>(stage))
+    {
+    case Profile::UnlockStage::CheckingPassword:
+        unlockProgress->setLabelText(tr("Checking password..."));
+        break;
+    case Profile::UnlockStage::PreparingKeys:
+        unlockProgress->setLabelText(tr("Preparing encryption keys..."));
+        break;
+    case Profile::UnlockStage::OpeningHistory:
+        unlockProgress->setLabelText(tr("Opening chat history..."));
+        break;
+    }
+}
+
+/**
+@brief Asks the running unlock to stop.
+
+The current stage can't be interrupted, so the profile stays locked until
+the unlock returns.
+*/
+void LoginScreen::onUnlockCancelled()
+{
+    if (!pendingUnlock)
+        return;
+
+    pendingUnlock->cancelled = true;
+    unlockProgress->setLabelText(tr("Cancelling..."));
+    unlockProgress->setCancelButton(nullptr);
+    unlockProgress->show();
+}
+
+void LoginScreen::onUnlockFinished()
+{
+    std::shared_ptr<Profile::Unlock> unlock = std::move(pendingUnlock);
+
+    if (unlockProgress)
+    {
+        unlockProgress->deleteLater();
+        unlockProgress = nullptr;
+    }
+
+    if (!unlock)
+        return;
+
+    if (unlock->cancelled || !unlockWatcher.result())
+    {
+        ProfileLocker::unlock();
+
+        if (unlock->wrongPassword)
         {
             QMessageBox::critical(this, tr("Couldn't load this profile"),
                                   tr("Wrong password."));
             ui->loginPassword->setFocus();
             ui->loginPassword->selectAll();
-            return;
         }
+        else if (!unlock->cancelled)
+        {
+            QMessageBox::critical(this, tr("Couldn't load this profile"),
+                                  tr("The profile couldn't be read."));
+        }
+
+        return;
     }
 
+    Profile* profile = Profile::loadUnlockedProfile(*unlock);
+
     Nexus& nexus = Nexus::getInstance();
 
     nexus.setProfile(profile);
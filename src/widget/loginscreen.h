@@ -24,6 +24,11 @@
 #include <QWidget>
 #include <QShortcut>
 #include <QToolButton>
+#include <QFutureWatcher>
+#include <memory>
+#include "src/persistence/profile.h"
+
+class QProgressDialog;
 
 namespace Ui {
 class LoginScreen;
@@ -56,6 +61,10 @@ private slots:
     void onCreateNewProfile();
     void onLogin();
     void onImportProfile();
+    // Profile unlocking
+    void onUnlockStageChanged(int stage);
+    void onUnlockCancelled();
+    void onUnlockFinished();
 
 private:
     void retranslateUi();
@@ -66,6 +75,9 @@ private:
 private:
     Ui::LoginScreen *ui;
     QShortcut quitShortcut;
+    QFutureWatcher<bool> unlockWatcher;
+    std::shared_ptr<Profile::Unlock> pendingUnlock;
+    QProgressDialog* unlockProgress = nullptr;
 };
 
 #endif // LOGINSCREEN_H
@@ -19,15 +19,19 @@
 
 #include "maskablepixmapwidget.h"
 #include <QPainter>
+#include <QPixmapCache>
 
 /**
-@var QPixmap* MaskablePixmapWidget::renderTarget
-@brief pointer to dynamically call the constructor.
+@var QPixmap MaskablePixmapWidget::renderTarget
+@brief The masked avatar, composited once and shared through QPixmapCache.
+
+Widgets showing the same avatar at the same size with the same mask share
+a single composited pixmap. The cache key contains the avatar's cacheKey(),
+so a new avatar never hits a stale entry.
 */
 
 MaskablePixmapWidget::MaskablePixmapWidget(QWidget *parent, QSize size, QString maskName)
     : QWidget(parent)
-    , renderTarget(nullptr)
     , maskName(maskName)
     , clickable(false)
 {
@@ -36,7 +40,6 @@ MaskablePixmapWidget::MaskablePixmapWidget(QWidget *parent, QSize size, QString
 
 MaskablePixmapWidget::~MaskablePixmapWidget()
 {
-    delete renderTarget;
 }
 
 void MaskablePixmapWidget::setClickable(bool clickable)
@@ -54,48 +57,81 @@ void MaskablePixmapWidget::setPixmap(const QPixmap &pmap)
     if (!pmap.isNull())
     {
         unscaled = pmap;
-        pixmap = pmap.scaled(width() - 2, height() - 2, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
-        update();
+        updatePixmap();
     }
 }
 
 QPixmap MaskablePixmapWidget::getPixmap() const
 {
-    return *renderTarget;
+    return renderTarget;
 }
 
 void MaskablePixmapWidget::setSize(QSize size)
 {
     setFixedSize(size);
-    delete renderTarget;
-    renderTarget = new QPixmap(size);
+    updatePixmap();
+}
 
-    QPixmap pmapMask = QPixmap(maskName);
-    if (!pmapMask.isNull())
-        mask = pmapMask.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+void MaskablePixmapWidget::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, renderTarget);
+}
 
-    if (!unscaled.isNull())
+/**
+@brief Composites the avatar with the mask, or fetches the result from the cache.
+*/
+void MaskablePixmapWidget::updatePixmap()
+{
+    const QSize targetSize = this->QWidget::size();
+    const QString key = QStringLiteral("maskable_%1_%2x%3_%4").arg(unscaled.cacheKey())
+                        .arg(targetSize.width()).arg(targetSize.height()).arg(maskName);
+
+    if (!QPixmapCache::find(key, &renderTarget))
     {
-        pixmap = unscaled.scaled(width() - 2, height() - 2, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
-        update();
+        renderTarget = QPixmap(targetSize);
+        renderTarget.fill(Qt::transparent);
+
+        if (!unscaled.isNull())
+        {
+            QPixmap pixmap = unscaled.scaled(targetSize.width() - 2, targetSize.height() - 2,
+                                             Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+            QPoint offset((targetSize.width() - pixmap.width())/2,
+                          (targetSize.height() - pixmap.height())/2); // centering the pixmap
+
+            QPainter painter(&renderTarget);
+            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+            painter.drawPixmap(offset, pixmap);
+            painter.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+            painter.drawPixmap(0, 0, getMask(maskName, targetSize));
+            painter.end();
+        }
+
+        QPixmapCache::insert(key, renderTarget);
     }
+
+    update();
 }
 
-void MaskablePixmapWidget::paintEvent(QPaintEvent *)
+/**
+@brief Returns the mask scaled to size, loading it from resources only once per size.
+*/
+QPixmap MaskablePixmapWidget::getMask(const QString& maskName, QSize size)
 {
-    renderTarget->fill(Qt::transparent);
+    const QString key = QStringLiteral("maskable_mask_%1x%2_%3").arg(size.width())
+                        .arg(size.height()).arg(maskName);
 
-    QPoint offset((width() - pixmap.size().width())/2,(height() - pixmap.size().height())/2); // centering the pixmap
+    QPixmap mask;
+    if (!QPixmapCache::find(key, &mask))
+    {
+        mask = QPixmap(maskName);
+        if (!mask.isNull())
+            mask = mask.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
 
-    QPainter painter(renderTarget);
-    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-    painter.drawPixmap(offset,pixmap);
-    painter.setCompositionMode(QPainter::CompositionMode_DestinationIn);
-    painter.drawPixmap(0,0,mask);
-    painter.end();
+        QPixmapCache::insert(key, mask);
+    }
 
-    painter.begin(this);
-    painter.drawPixmap(0,0,*renderTarget);
+    return mask;
 }
 
 void MaskablePixmapWidget::mousePressEvent(QMouseEvent*)
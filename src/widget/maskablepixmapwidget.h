@@ -42,8 +42,11 @@ protected:
     virtual void mousePressEvent(QMouseEvent *) final override;
 
 private:
-    QPixmap pixmap, mask, unscaled;
-    QPixmap* renderTarget;
+    void updatePixmap();
+    static QPixmap getMask(const QString& maskName, QSize size);
+
+private:
+    QPixmap renderTarget, unscaled;
     QSize size;
     QString maskName;
     bool clickable;
@@ -24,12 +24,14 @@
 #include <QFile>
 #include <QDebug>
 #include <QMap>
+#include <QHash>
 #include <QRegularExpression>
 #include <QWidget>
 #include <QStyle>
 #include <QFontInfo>
 #include <QSvgRenderer>
 #include <QPainter>
+#include <QCache>
 
 /**
 @enum Style::Font
@@ -96,6 +98,36 @@ static QColor palette[] = {
 
 static QMap<QString, QString> dict;
 
+static const QString baseFontVariable = QStringLiteral("@baseFont");
+
+/**
+@brief Stylesheet split at its variables, so it can be rendered again without parsing.
+
+There is one more literal than there are variables, the text is
+literals[0] + variables[0] + literals[1] + ... + literals[n].
+*/
+struct StylesheetTemplate
+{
+    QStringList literals;
+    QStringList variables;
+    bool themed = false;
+};
+
+struct ResolvedStylesheet
+{
+    QString qss;
+    bool themed;
+};
+
+// compiled stylesheet files, their contents never change at runtime
+static QHash<QString, StylesheetTemplate> templateCache;
+
+// resolved stylesheets, themed ones are dropped when the theme color changes
+static QHash<QString, ResolvedStylesheet> stylesheetCache;
+
+// rasterized SVGs, the cost of an entry is its size in KiB
+static QCache<QString, QPixmap> svgCache(8 * 1024);
+
 QStringList Style::getThemeColorNames()
 {
     return {QObject::tr("Default"), QObject::tr("Blue"), QObject::tr("Olive"), QObject::tr("Red"), QObject::tr("Violet")};
@@ -103,16 +135,115 @@ QStringList Style::getThemeColorNames()
 
 QList<QColor> Style::themeColorColors = {QColor(), QColor("#004aa4"), QColor("#97ba00"), QColor("#c23716"), QColor("#4617b5")};
 
+static void initDict()
+{
+    if (!dict.isEmpty())
+        return;
+
+    dict = {
+        // colors
+        {"@green", Style::getColor(Style::Green).name()},
+        {"@yellow", Style::getColor(Style::Yellow).name()},
+        {"@red", Style::getColor(Style::Red).name()},
+        {"@black", Style::getColor(Style::Black).name()},
+        {"@darkGrey", Style::getColor(Style::DarkGrey).name()},
+        {"@mediumGrey", Style::getColor(Style::MediumGrey).name()},
+        {"@mediumGreyLight", Style::getColor(Style::MediumGreyLight).name()},
+        {"@lightGrey", Style::getColor(Style::LightGrey).name()},
+        {"@white", Style::getColor(Style::White).name()},
+        {"@orange", Style::getColor(Style::Orange).name()},
+        {"@themeDark", Style::getColor(Style::ThemeDark).name()},
+        {"@themeMediumDark", Style::getColor(Style::ThemeMediumDark).name()},
+        {"@themeMedium", Style::getColor(Style::ThemeMedium).name()},
+        {"@themeLight", Style::getColor(Style::ThemeLight).name()},
+
+        // fonts
+        {"@extraBig", qssifyFont(Style::getFont(Style::ExtraBig))},
+        {"@big", qssifyFont(Style::getFont(Style::Big))},
+        {"@bigBold", qssifyFont(Style::getFont(Style::BigBold))},
+        {"@medium", qssifyFont(Style::getFont(Style::Medium))},
+        {"@mediumBold", qssifyFont(Style::getFont(Style::MediumBold))},
+        {"@small", qssifyFont(Style::getFont(Style::Small))},
+        {"@smallLight", qssifyFont(Style::getFont(Style::SmallLight))}
+    };
+}
+
+/**
+@brief Splits a stylesheet at the variables it uses.
+
+Words starting with @ that aren't known variables are kept as they are.
+*/
+static StylesheetTemplate compileStylesheet(const QString& qss)
+{
+    static const QRegularExpression variable("@\\w+");
+    initDict();
+
+    StylesheetTemplate tmpl;
+    int pos = 0;
+    QRegularExpressionMatchIterator it = variable.globalMatch(qss);
+    while (it.hasNext())
+    {
+        QRegularExpressionMatch match = it.next();
+        const QString name = match.captured();
+        if (name != baseFontVariable && !dict.contains(name))
+            continue;
+
+        tmpl.literals << qss.mid(pos, match.capturedStart() - pos);
+        tmpl.variables << name;
+        tmpl.themed |= name.startsWith(QLatin1String("@theme"));
+        pos = match.capturedEnd();
+    }
+
+    tmpl.literals << qss.mid(pos);
+    return tmpl;
+}
+
+static QString renderStylesheet(const StylesheetTemplate& tmpl, const QFont& baseFont)
+{
+    QString qss = tmpl.literals[0];
+    for (int i = 0; i < tmpl.variables.size(); ++i)
+    {
+        const QString& name = tmpl.variables[i];
+        if (name == baseFontVariable)
+            qss += QString::fromUtf8("'%1' %2px").arg(baseFont.family()).arg(QFontInfo(baseFont).pixelSize());
+        else
+            qss += dict.value(name);
+
+        qss += tmpl.literals[i + 1];
+    }
+
+    return qss;
+}
+
+/**
+@brief Returns a stylesheet file with its variables resolved.
+
+Files are read and compiled once, the result is cached until the theme color
+changes, and only if it uses theme colors.
+*/
 QString Style::getStylesheet(const QString &filename, const QFont& baseFont)
 {
-    QFile file(filename);
-    if (!file.open(QFile::ReadOnly | QFile::Text))
+    const QString key = filename + baseFont.key();
+    auto it = stylesheetCache.constFind(key);
+    if (it != stylesheetCache.constEnd())
+        return it.value().qss;
+
+    auto tmpl = templateCache.constFind(filename);
+    if (tmpl == templateCache.constEnd())
     {
-        qWarning() << "Stylesheet " << filename << " not found";
-        return QString();
+        QFile file(filename);
+        if (!file.open(QFile::ReadOnly | QFile::Text))
+        {
+            qWarning() << "Stylesheet " << filename << " not found";
+            return QString();
+        }
+
+        tmpl = templateCache.insert(filename, compileStylesheet(QString::fromUtf8(file.readAll())));
     }
 
-    return resolve(file.readAll(), baseFont);
+    QString qss = renderStylesheet(tmpl.value(), baseFont);
+    stylesheetCache.insert(key, {qss, tmpl.value().themed});
+    return qss;
 }
 
 QColor Style::getColor(Style::ColorPalette entry)
@@ -142,44 +273,62 @@ QFont Style::getFont(Style::Font font)
 
 QString Style::resolve(QString qss, const QFont& baseFont)
 {
-    if (dict.isEmpty())
-    {
-        dict = {
-            // colors
-            {"@green", Style::getColor(Style::Green).name()},
-            {"@yellow", Style::getColor(Style::Yellow).name()},
-            {"@red", Style::getColor(Style::Red).name()},
-            {"@black", Style::getColor(Style::Black).name()},
-            {"@darkGrey", Style::getColor(Style::DarkGrey).name()},
-            {"@mediumGrey", Style::getColor(Style::MediumGrey).name()},
-            {"@mediumGreyLight", Style::getColor(Style::MediumGreyLight).name()},
-            {"@lightGrey", Style::getColor(Style::LightGrey).name()},
-            {"@white", Style::getColor(Style::White).name()},
-            {"@orange", Style::getColor(Style::Orange).name()},
-            {"@themeDark", Style::getColor(Style::ThemeDark).name()},
-            {"@themeMediumDark", Style::getColor(Style::ThemeMediumDark).name()},
-            {"@themeMedium", Style::getColor(Style::ThemeMedium).name()},
-            {"@themeLight", Style::getColor(Style::ThemeLight).name()},
-
-            // fonts
-            {"@baseFont", QString::fromUtf8("'%1' %2px")
-             .arg(baseFont.family()).arg(QFontInfo(baseFont).pixelSize())},
-            {"@extraBig", qssifyFont(Style::getFont(Style::ExtraBig))},
-            {"@big", qssifyFont(Style::getFont(Style::Big))},
-            {"@bigBold", qssifyFont(Style::getFont(Style::BigBold))},
-            {"@medium", qssifyFont(Style::getFont(Style::Medium))},
-            {"@mediumBold", qssifyFont(Style::getFont(Style::MediumBold))},
-            {"@small", qssifyFont(Style::getFont(Style::Small))},
-            {"@smallLight", qssifyFont(Style::getFont(Style::SmallLight))}
-        };
-    }
+    return renderStylesheet(compileStylesheet(qss), baseFont);
+}
 
-    for (const QString& key : dict.keys())
+/**
+@brief Restricts a stylesheet to the widgets carrying a dynamic property value.
+@param qss Stylesheet to restrict.
+@param property Name of the dynamic property.
+@param value Value the property must have.
+@return Stylesheet whose rules only apply to the tagged widget and its children.
+
+This allows stylesheets written for a single widget to be merged into the stylesheet
+of a common container, so that Qt parses them once instead of once per widget.
+*/
+QString Style::scopeStylesheet(QString qss, const QString& property, const QString& value)
+{
+    static const QRegularExpression comments("/\\*.*?\\*/", QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression combinator("[\\s>]");
+    qss.remove(comments);
+
+    const QString attribute = QString("[%1=\"%2\"]").arg(property, value);
+    QString scoped;
+    int pos = 0;
+    while (true)
     {
-        qss.replace(QRegularExpression(QString("%1\\b").arg(key)), dict[key]);
+        int open = qss.indexOf('{', pos);
+        if (open < 0)
+            break;
+
+        int close = qss.indexOf('}', open);
+        if (close < 0)
+            break;
+
+        QStringList selectors;
+        for (QString selector : qss.mid(pos, open - pos).split(',', QString::SkipEmptyParts))
+        {
+            selector = selector.trimmed();
+            if (selector.isEmpty())
+                continue;
+
+            // the tagged widget itself, the attribute goes right after the type name
+            int nameEnd = selector.lastIndexOf(combinator) + 1;
+            while (nameEnd < selector.size()
+                   && (selector[nameEnd].isLetterOrNumber() || selector[nameEnd] == '_'))
+                ++nameEnd;
+
+            selectors << QString(selector).insert(nameEnd, attribute);
+
+            // its children
+            selectors << attribute + " " + selector;
+        }
+
+        scoped += selectors.join(", ") + " " + qss.mid(open, close - open + 1) + "\n";
+        pos = close + 1;
     }
 
-    return qss;
+    return scoped;
 }
 
 void Style::repolish(QWidget *w)
@@ -211,29 +360,49 @@ void Style::setThemeColor(int color)
 @param color Color to set.
 
 Pass an invalid QColor to reset to defaults.
+Only the resolved stylesheets that use theme colors are dropped.
 */
 void Style::setThemeColor(const QColor &color)
 {
+    QColor themeDark, themeMediumDark, themeMedium, themeLight;
     if (!color.isValid())
     {
         // Reset to default
-        palette[ThemeDark] = QColor("#1c1c1c");
-        palette[ThemeMediumDark] = QColor("#2a2a2a");
-        palette[ThemeMedium] = QColor("#414141");
-        palette[ThemeLight] = QColor("#4e4e4e");
+        themeDark = QColor("#1c1c1c");
+        themeMediumDark = QColor("#2a2a2a");
+        themeMedium = QColor("#414141");
+        themeLight = QColor("#4e4e4e");
     }
     else
     {
-        palette[ThemeDark] = color.darker(155);
-        palette[ThemeMediumDark] = color.darker(135);
-        palette[ThemeMedium] = color.darker(120);
-        palette[ThemeLight] = color.lighter(110);
+        themeDark = color.darker(155);
+        themeMediumDark = color.darker(135);
+        themeMedium = color.darker(120);
+        themeLight = color.lighter(110);
     }
 
+    if (palette[ThemeDark] == themeDark && palette[ThemeMediumDark] == themeMediumDark
+            && palette[ThemeMedium] == themeMedium && palette[ThemeLight] == themeLight)
+        return;
+
+    palette[ThemeDark] = themeDark;
+    palette[ThemeMediumDark] = themeMediumDark;
+    palette[ThemeMedium] = themeMedium;
+    palette[ThemeLight] = themeLight;
+
+    initDict();
     dict["@themeDark"] = getColor(ThemeDark).name();
     dict["@themeMediumDark"] = getColor(ThemeMediumDark).name();
     dict["@themeMedium"] = getColor(ThemeMedium).name();
     dict["@themeLight"] = getColor(ThemeLight).name();
+
+    for (auto it = stylesheetCache.begin(); it != stylesheetCache.end();)
+    {
+        if (it.value().themed)
+            it = stylesheetCache.erase(it);
+        else
+            ++it;
+    }
 }
 
 /**
@@ -244,12 +413,32 @@ void Style::applyTheme()
     GUI::reloadTheme();
 }
 
-QPixmap Style::scaleSvgImage(const QString& path, uint32_t width, uint32_t height)
+/**
+@brief Renders an SVG image to a pixmap of the given size.
+@param path Path to the SVG file.
+@param width Width of the pixmap in device independent pixels.
+@param height Height of the pixmap in device independent pixels.
+@param dpr Device pixel ratio to render at.
+@return The rendered pixmap.
+
+Rendered images are kept in a bounded cache keyed by path, size and device
+pixel ratio, so repeated calls with the same arguments don't rasterize again.
+*/
+QPixmap Style::scaleSvgImage(const QString& path, uint32_t width, uint32_t height, qreal dpr)
 {
+    const QString key = QString("%1:%2x%3@%4").arg(path).arg(width).arg(height).arg(dpr);
+    if (QPixmap* cached = svgCache.object(key))
+        return *cached;
+
     QSvgRenderer render(path);
-    QPixmap pixmap(width, height);
+    QPixmap pixmap(qRound(width * dpr), qRound(height * dpr));
     pixmap.fill(QColor(0, 0, 0, 0));
     QPainter painter(&pixmap);
     render.render(&painter, pixmap.rect());
+    painter.end();
+    pixmap.setDevicePixelRatio(dpr);
+
+    int cost = qMax(1, pixmap.width() * pixmap.height() * pixmap.depth() / 8 / 1024);
+    svgCache.insert(key, new QPixmap(pixmap), cost);
     return pixmap;
 }
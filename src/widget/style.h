@@ -63,11 +63,12 @@ public:
     static QColor getColor(ColorPalette entry);
     static QFont getFont(Font font);
     static QString resolve(QString qss, const QFont& baseFont = QFont());
+    static QString scopeStylesheet(QString qss, const QString& property, const QString& value);
     static void repolish(QWidget* w);
     static void setThemeColor(int color);
     static void setThemeColor(const QColor &color);
     static void applyTheme();
-    static QPixmap scaleSvgImage(const QString& path, uint32_t width, uint32_t height);
+    static QPixmap scaleSvgImage(const QString& path, uint32_t width, uint32_t height, qreal dpr = 1.0);
 
     static QList<QColor> themeColorColors;
 
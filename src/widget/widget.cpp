@@ -23,6 +23,7 @@
 #include "src/core/core.h"
 #include "src/core/coreav.h"
 #include "src/persistence/settings.h"
+#include "src/allocstats.h"
 #include "contentdialog.h"
 #include "src/friend.h"
 #include "src/friendlist.h"
@@ -96,6 +97,13 @@ bool toxActivateEventHandler(const QByteArray&)
 
 Widget *Widget::instance{nullptr};
 
+// Messages closer than this to the previous one for a window only extend its alert burst, in ms
+static const qint64 alertBurstInterval = 3000;
+// Minimum time between two notification sounds of the same chat, in ms
+static const qint64 chatSoundInterval = 5000;
+// Minimum time between two notification sounds of any chats, in ms
+static const qint64 globalSoundInterval = 1000;
+
 Widget::Widget(QWidget *parent)
     : QMainWindow(parent),
       icon{nullptr},
@@ -103,8 +111,10 @@ Widget::Widget(QWidget *parent)
       ui(new Ui::MainWindow),
       activeChatroomWidget{nullptr},
       eventFlag(false),
-      eventIcon(false)
+      eventIcon(false),
+      lastSound(-globalSoundInterval)
 {
+    alertClock.start();
     installEventFilter(this);
     Translator::translate();
 }
@@ -241,8 +251,8 @@ void Widget::init()
     connect(actionLogout, &QAction::triggered, profileForm, &ProfileForm::onLogoutClicked);
 
     Core* core = Nexus::getCore();
-    connect(core, &Core::fileDownloadFinished, filesForm, &FilesForm::onFileDownloadComplete);
-    connect(core, &Core::fileUploadFinished, filesForm, &FilesForm::onFileUploadComplete);
+    connect(core, &Core::fileTransferFinished, filesForm, &FilesForm::onFileTransferFinished);
+    connect(core, &Core::fileTransferCancelled, filesForm, &FilesForm::onFileTransferCancelled);
     connect(settingsWidget, &SettingsWidget::setShowSystemTray, this, &Widget::onSetShowSystemTray);
     connect(core, &Core::selfAvatarChanged, profileForm, &ProfileForm::onSelfAvatarLoaded);
     connect(ui->addButton, &QPushButton::clicked, this, &Widget::onAddClicked);
@@ -481,23 +491,34 @@ void Widget::updateIcons()
         }
     }
 
-    QIcon ico;
-    if (!hasThemeIconBug && QIcon::hasThemeIcon("qtox-" + status))
-    {
-        ico = QIcon::fromTheme("qtox-" + status);
-    }
-    else
+    // The icon blinks every second while there are unread messages,
+    // so each variant is looked up and rendered only once.
+    static QHash<QString, QIcon> icons;
+
+    QString color = Settings::getInstance().getLightTrayIcon() ? "light" : "dark";
+    QString key = color + "/" + status;
+    QIcon ico = icons.value(key);
+
+    if (ico.isNull())
     {
-        QString color = Settings::getInstance().getLightTrayIcon() ? "light" : "dark";
-        QString path = ":/img/taskbar/" + color + "/taskbar_" + status + ".svg";
-        QSvgRenderer renderer(path);
+        if (!hasThemeIconBug && QIcon::hasThemeIcon("qtox-" + status))
+        {
+            ico = QIcon::fromTheme("qtox-" + status);
+        }
+        else
+        {
+            QString path = ":/img/taskbar/" + color + "/taskbar_" + status + ".svg";
+            QSvgRenderer renderer(path);
+
+            // Prepare a QImage with desired characteritisc
+            QImage image = QImage(250, 250, QImage::Format_ARGB32);
+            image.fill(Qt::transparent);
+            QPainter painter(&image);
+            renderer.render(&painter);
+            ico = QIcon(QPixmap::fromImage(image));
+        }
 
-        // Prepare a QImage with desired characteritisc
-        QImage image = QImage(250, 250, QImage::Format_ARGB32);
-        image.fill(Qt::transparent);
-        QPainter painter(&image);
-        renderer.render(&painter);
-        ico = QIcon(QPixmap::fromImage(image));
+        icons.insert(key, ico);
     }
 
     setWindowIcon(ico);
@@ -971,9 +992,9 @@ void Widget::addFriend(int friendId, const QString &userId)
     connect(newfriend->getChatForm(), &ChatForm::sendFile, core, &Core::sendFile);
     connect(newfriend->getChatForm(), &ChatForm::aliasChanged, newfriend->getFriendWidget(), &FriendWidget::setAlias);
     connect(core, &Core::fileReceiveRequested, newfriend->getChatForm(), &ChatForm::onFileRecvRequest);
-    connect(coreav, &CoreAV::avInvite, newfriend->getChatForm(), &ChatForm::onAvInvite, Qt::BlockingQueuedConnection);
-    connect(coreav, &CoreAV::avStart, newfriend->getChatForm(), &ChatForm::onAvStart, Qt::BlockingQueuedConnection);
-    connect(coreav, &CoreAV::avEnd, newfriend->getChatForm(), &ChatForm::onAvEnd, Qt::BlockingQueuedConnection);
+    connect(coreav, &CoreAV::avInvite, newfriend->getChatForm(), &ChatForm::onAvInvite);
+    connect(coreav, &CoreAV::avStart, newfriend->getChatForm(), &ChatForm::onAvStart);
+    connect(coreav, &CoreAV::avEnd, newfriend->getChatForm(), &ChatForm::onAvEnd);
     connect(core, &Core::friendAvatarChanged, newfriend->getChatForm(), &ChatForm::onAvatarChange);
     connect(core, &Core::friendAvatarChanged, newfriend->getFriendWidget(), &FriendWidget::onAvatarChange);
     connect(core, &Core::friendAvatarRemoved, newfriend->getChatForm(), &ChatForm::onAvatarRemoved);
@@ -1010,6 +1031,8 @@ void Widget::onFriendshipChanged(int friendId)
 
 void Widget::onFriendStatusChanged(int friendId, Status status)
 {
+    ALLOC_SCOPE(Widgets);
+
     Friend* f = FriendList::findFriend(friendId);
     if (!f)
         return;
@@ -1141,6 +1164,8 @@ void Widget::onChatroomWidgetClicked(GenericChatroomWidget *widget, bool group)
 
 void Widget::onFriendMessageReceived(int friendId, const QString& message, bool isAction)
 {
+    ALLOC_SCOPE(Widgets);
+
     Friend* f = FriendList::findFriend(friendId);
     if (!f)
         return;
@@ -1233,7 +1258,7 @@ bool Widget::newFriendMessageAlert(int friendId, bool sound)
         }
     }
 
-    if (newMessageAlert(currentWindow, hasActive, sound))
+    if (newMessageAlert(currentWindow, hasActive, sound, true, f->getFriendWidget()))
     {
         f->setEventFlag(true);
         f->getFriendWidget()->updateStatusLight();
@@ -1273,7 +1298,7 @@ bool Widget::newGroupMessageAlert(int groupId, bool notify)
         hasActive = g->getGroupWidget() == activeChatroomWidget;
     }
 
-    if (newMessageAlert(currentWindow, hasActive, true, notify))
+    if (newMessageAlert(currentWindow, hasActive, true, notify, g->getGroupWidget()))
     {
         g->setEventFlag(true);
         g->getGroupWidget()->updateStatusLight();
@@ -1313,7 +1338,21 @@ QString Widget::fromDialogType(DialogType type)
     }
 }
 
-bool Widget::newMessageAlert(QWidget* currentWindow, bool isActive, bool sound, bool notify)
+/**
+@brief Alerts the user of a new message, coalescing bursts.
+@param currentWindow Window showing the chat.
+@param isActive True if the chat is the active one of its window.
+@param sound False to never play the notification sound.
+@param notify False to only report whether the message is unseen.
+@param chat Widget of the friend or group the message is for, nullptr if none.
+@return True if the message is unseen.
+
+A window is only alerted and raised for the first message of a burst, that
+is messages closer than alertBurstInterval to the previous one. The sound is
+limited per chat and across chats, so a busy group can't keep it playing.
+*/
+bool Widget::newMessageAlert(QWidget* currentWindow, bool isActive, bool sound, bool notify,
+                             const GenericChatroomWidget* chat)
 {
     bool inactiveWindow = isMinimized() || !currentWindow->isActiveWindow();
 
@@ -1322,13 +1361,30 @@ bool Widget::newMessageAlert(QWidget* currentWindow, bool isActive, bool sound,
 
     if (notify)
     {
+        qint64 now = alertClock.elapsed();
+        auto lastAlert = lastWindowAlert.constFind(currentWindow);
+        bool newBurst = lastAlert == lastWindowAlert.constEnd() || now - *lastAlert >= alertBurstInterval;
+
+        // content dialogs come and go, forget them so a new one at the same address starts afresh
+        if (lastAlert == lastWindowAlert.constEnd())
+        {
+            connect(currentWindow, &QObject::destroyed, this, [this](QObject* window)
+            {
+                lastWindowAlert.remove(window);
+            });
+        }
+
+        lastWindowAlert[currentWindow] = now;
+
         if (inactiveWindow)
         {
-            QApplication::alert(currentWindow);
+            if (newBurst)
+                QApplication::alert(currentWindow);
+
             eventFlag = true;
         }
 
-        if (Settings::getInstance().getShowWindow())
+        if (newBurst && Settings::getInstance().getShowWindow())
         {
             currentWindow->show();
             if (inactiveWindow && Settings::getInstance().getShowInFront())
@@ -1339,8 +1395,16 @@ bool Widget::newMessageAlert(QWidget* currentWindow, bool isActive, bool sound,
         bool busySound = Settings::getInstance().getBusySound();
         bool notifySound = Settings::getInstance().getNotifySound();
 
-        if (notifySound && sound && (!isBusy || busySound))
-            Audio::getInstance().playMono16Sound(QStringLiteral(":/audio/notification.pcm"));
+        if (notifySound && sound && (!isBusy || busySound) && now - lastSound >= globalSoundInterval)
+        {
+            auto lastChat = lastChatSound.constFind(chat);
+            if (lastChat == lastChatSound.constEnd() || now - *lastChat >= chatSoundInterval)
+            {
+                lastChatSound[chat] = now;
+                lastSound = now;
+                Audio::getInstance().playMono16Sound(QStringLiteral(":/audio/notification.pcm"));
+            }
+        }
     }
 
     return true;
@@ -1360,11 +1424,8 @@ void Widget::updateFriendActivity(Friend *frnd)
     QDate date = Settings::getInstance().getFriendActivity(frnd->getToxId());
     if (date != QDate::currentDate())
     {
-        // Update old activity before after new one. Store old date first.
-        QDate oldDate = Settings::getInstance().getFriendActivity(frnd->getToxId());
         Settings::getInstance().setFriendActivity(frnd->getToxId(), QDate::currentDate());
         contactListWidget->moveWidget(frnd->getFriendWidget(), frnd->getStatus());
-        contactListWidget->updateActivityDate(oldDate);
     }
 }
 
@@ -1398,6 +1459,7 @@ void Widget::removeFriend(Friend* f, bool fake)
     FriendList::removeFriend(f->getFriendID(), fake);
     Nexus::getCore()->removeFriend(f->getFriendID(), fake);
 
+    lastChatSound.remove(f->getFriendWidget());
     delete f;
     if (contentLayout != nullptr && contentLayout->mainHead->layout()->isEmpty())
         onAddClicked();
@@ -1640,6 +1702,7 @@ void Widget::removeGroup(Group* g, bool fake)
         contentDialog->removeGroup(g->getGroupId());
 
     Nexus::getCore()->removeGroup(g->getGroupId(), fake);
+    lastChatSound.remove(g->getGroupWidget());
     delete g;
     if (contentLayout != nullptr && contentLayout->mainHead->layout()->isEmpty())
         onAddClicked();
@@ -1987,15 +2050,31 @@ void Widget::clearAllReceipts()
         f->getChatForm()->getOfflineMsgEngine()->removeAllReceipts();
 }
 
+/**
+@brief Sets a stylesheet unless the widget already has it.
+@return True if the stylesheet changed.
+
+Setting a stylesheet repolishes the widget and all its children, even when it's the same.
+*/
+static bool updateStyleSheet(QWidget* widget, const QString& qss)
+{
+    if (widget->styleSheet() == qss)
+        return false;
+
+    widget->setStyleSheet(qss);
+    return true;
+}
+
 void Widget::reloadTheme()
 {
     QString statusPanelStyle = Style::getStylesheet(":/ui/window/statusPanel.css");
-    ui->tooliconsZone->setStyleSheet(Style::getStylesheet(":/ui/tooliconsZone/tooliconsZone.css"));
-    ui->statusPanel->setStyleSheet(statusPanelStyle);
-    ui->statusHead->setStyleSheet(statusPanelStyle);
-    ui->friendList->setStyleSheet(Style::getStylesheet(":/ui/friendList/friendList.css"));
-    ui->statusButton->setStyleSheet(Style::getStylesheet(":/ui/statusButton/statusButton.css"));
-    contactListWidget->reDraw();
+    bool changed = updateStyleSheet(ui->tooliconsZone, Style::getStylesheet(":/ui/tooliconsZone/tooliconsZone.css"));
+    changed |= updateStyleSheet(ui->statusPanel, statusPanelStyle);
+    changed |= updateStyleSheet(ui->statusHead, statusPanelStyle);
+    changed |= updateStyleSheet(ui->friendList, Style::getStylesheet(":/ui/friendList/friendList.css"));
+    changed |= updateStyleSheet(ui->statusButton, Style::getStylesheet(":/ui/statusButton/statusButton.css"));
+    if (changed)
+        contactListWidget->reDraw();
 
     for (Friend* f : FriendList::getAllFriends())
         f->getFriendWidget()->reloadTheme();
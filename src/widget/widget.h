@@ -23,6 +23,8 @@
 #include <QMainWindow>
 #include <QSystemTrayIcon>
 #include <QFileInfo>
+#include <QElapsedTimer>
+#include <QHash>
 #include "src/core/corestructs.h"
 #include "genericchatitemwidget.h"
 
@@ -213,7 +215,8 @@ private:
     };
 
 private:
-    bool newMessageAlert(QWidget* currentWindow, bool isActive, bool sound = true, bool notify = true);
+    bool newMessageAlert(QWidget* currentWindow, bool isActive, bool sound = true, bool notify = true,
+                         const GenericChatroomWidget* chat = nullptr);
     void setActiveToolMenuButton(ActiveToolMenuButton newActiveButton);
     void hideMainForms(GenericChatroomWidget* chatroomWidget);
     Group *createGroup(int groupId);
@@ -274,6 +277,10 @@ private:
     QRegExp nameMention, sanitizedNameMention;
     bool eventFlag;
     bool eventIcon;
+    QElapsedTimer alertClock;
+    QHash<const QObject*, qint64> lastWindowAlert;
+    QHash<const GenericChatroomWidget*, qint64> lastChatSound;
+    qint64 lastSound;
     bool wasMaximized = false;
     QPushButton* friendRequestsButton;
     QPushButton* groupInvitesButton;